@@ -0,0 +1,86 @@
+#!/bin/sh
+# runs fixed seed campaigns against the synthetic targets and prints
+# one line of numbers for each of them, so that changes to the executor,
+# the mutator and the minimizer can be compared by running this before
+# and after the change
+#
+# the campaigns that look for an anomaly use a single job, which keeps
+# the execution counts the same from run to run with the same seed
+#
+# environment variables:
+#   FUZZER  path to dos-fuzzer (default: ./dos-fuzzer)
+#   SHIM    path to the forkserver shim (default: ./libdos-fuzzer-forkserver.so)
+#   TARGETS directory of the built targets (default: ./bench/bin)
+#   JOBS    jobs for the throughput campaigns (default: nproc)
+#   EXECS   executions for the throughput campaigns (default: 20000)
+#   SEED    seed for all of the campaigns (default: 1)
+
+set -e
+
+FUZZER=${FUZZER:-./dos-fuzzer}
+SHIM=${SHIM:-./libdos-fuzzer-forkserver.so}
+TARGETS=${TARGETS:-./bench/bin}
+JOBS=${JOBS:-$(nproc)}
+EXECS=${EXECS:-20000}
+SEED=${SEED:-1}
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+# a file of spaces, none of the targets do anything special with it
+input="$work/input.bin"
+head -c 4096 /dev/zero | tr '\0' ' ' > "$input"
+
+# read a number from the status file of a campaign
+stat_field()
+{
+	sed -n "s/^\t\"$2\": \([0-9.]*\),\{0,1\}$/\1/p" "$1/fuzzer_stats.json"
+}
+
+# run a campaign and print a line of results for it
+#
+# usage: bench <name> <dos-fuzzer arguments>
+bench()
+{
+	name=$1
+	shift
+
+	out="$work/$name"
+	if ! "$FUZZER" --seed "$SEED" -f "$input" -o "$out" "$@" > "$out.log" 2>&1 < /dev/null
+	then
+		echo "$name: dos-fuzzer failed, the last lines of the output were:"
+		tail -n 5 "$out.log"
+		exit 1
+	fi
+
+	first_ms=-
+	first_execs=-
+	if [ "$(stat_field "$out" first_finding_execs)" != 0 ]
+	then
+		first_ms=$(stat_field "$out" first_finding_ms)
+		first_execs=$(stat_field "$out" first_finding_execs)
+	fi
+
+	min_execs=$(stat_field "$out" minimization_executions)
+	min_bytes=$(tr '\r' '\n' < "$out.log" | sed -n 's/.*reproduced by changing \([0-9]*\) byte.*/\1/p')
+
+	printf '%-16s %10s %10s %10s %12s %10s %10s\n' "$name" \
+		"$(stat_field "$out" execs_per_sec)" "$(stat_field "$out" executions)" \
+		"$first_ms" "$first_execs" "$min_execs" "${min_bytes:--}"
+}
+
+printf '%-16s %10s %10s %10s %12s %10s %10s\n' benchmark execs/s execs first_ms first_execs min_execs min_bytes
+
+# executor and input throughput with a target that does nothing
+bench noop-file -c "$TARGETS/noop %c" -j "$JOBS" --max-execs "$EXECS"
+bench noop-memfd -c "$TARGETS/noop %c" -j "$JOBS" --max-execs "$EXECS" --input-mode memfd
+bench noop-stdin -c "$TARGETS/noop" -j "$JOBS" --max-execs "$EXECS" --input-mode stdin
+bench noop-forkserver -c "$TARGETS/noop %c" -j "$JOBS" --max-execs "$EXECS" --forkserver "$SHIM"
+
+# time to the first finding and the cost of minimizing it
+bench crash -c "$TARGETS/crash %c" -j 1 -a 40 -s 10 --ret
+#
+# the sleep target gets a wide margin on the execution time limit so
+# that scheduling hiccups don't get reported before the real slowdown
+bench sleep -c "$TARGETS/sleep %c" -j 1 -a 20 -s 10 --time -d 30 -v 100
+bench alloc -c "$TARGETS/alloc %c" -j 1 -a 8 -s 8 --mem --mem-limit 512
@@ -0,0 +1,34 @@
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+// allocates as many kilobytes as the 16-bit little endian
+// header field at 0x8 says and touches all of them
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+		return 1;
+
+	std::ifstream file(argv[1], std::ios::binary);
+	const std::vector<unsigned char> bytes{std::istreambuf_iterator<char>(file), {}};
+
+	if (bytes.size() < 0xa)
+		return 1;
+
+	const size_t size = (bytes[0x8] | bytes[0x9] << 8) * 1024;
+	if (size == 0)
+		return 0;
+
+	char* const buffer = static_cast<char*>(malloc(size));
+	if (!buffer)
+		return 2;
+
+	memset(buffer, 1, size);
+
+	const int result = buffer[size / 2] - 1;
+	free(buffer);
+
+	return result;
+}
@@ -0,0 +1,19 @@
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+// aborts if the file has the bytes ff ff at 0x40
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+		return 1;
+
+	std::ifstream file(argv[1], std::ios::binary);
+	const std::vector<unsigned char> bytes{std::istreambuf_iterator<char>(file), {}};
+
+	if (bytes.size() > 0x41 && bytes[0x40] == 0xff && bytes[0x41] == 0xff)
+		abort();
+
+	return 0;
+}
@@ -0,0 +1,6 @@
+// exits right away without even opening the file, so the
+// execution speed is only limited by the fuzzer itself
+int main()
+{
+	return 0;
+}
@@ -0,0 +1,20 @@
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <vector>
+
+// sleeps for a while if the byte at 0x20 is 0xf0 or above
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+		return 1;
+
+	std::ifstream file(argv[1], std::ios::binary);
+	const std::vector<unsigned char> bytes{std::istreambuf_iterator<char>(file), {}};
+
+	if (bytes.size() > 0x20 && bytes[0x20] >= 0xf0)
+		std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+	return 0;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <array>
+
+namespace fuzz
+{
+	// what kind of trouble a run of the command ran into
+	enum class anomaly
+	{
+		none,
+
+		// killed by a signal
+		signal,
+
+		// non-zero exit code that isn't ignored
+		exit_code,
+
+		// killed for going over the execution time limit
+		hang,
+
+		// exited on its own, but went over the execution time limit
+		slowdown,
+
+		// used abnormally much memory or cpu time
+		resource_exhaustion
+	};
+
+	constexpr std::array<const char*, 6> anomaly_names = {
+		"none", "crash", "exit code", "hang", "slowdown", "resource exhaustion"
+	};
+
+	// how many times a finding reproduced when it was run again
+	struct verification
+	{
+		u64 reproductions{0};
+		u64 runs{0};
+
+		// more than half of the runs need to run into the same
+		// kind of an anomaly, findings that weren't run again at
+		// all are taken as they are
+		bool confirmed() const noexcept
+		{
+			return runs == 0 || reproductions * 2 > runs;
+		}
+	};
+}
@@ -1,5 +1,9 @@
 #pragma once
 
+#include "enumerator.hpp"
+#include "layout.hpp"
+#include "mutator.hpp"
+#include "section.hpp"
 #include "types.hpp"
 
 #include <string>
@@ -11,24 +15,97 @@ namespace fuzz
 	{
 		continuous,
 		ret,
-		time
+		time,
+		mem,
+		slowdown
+	};
+
+	// what the execution time limit of the time mode is compared against
+	enum class time_metric
+	{
+		// the time from starting the command to it exiting
+		wall,
+
+		// the user and system time of the command, which doesn't
+		// depend on the load of the machine as much
+		cpu,
+
+		// instructions retired by the command in user space, which
+		// are almost the same from run to run
+		instructions
+	};
+
+	// how the patched file is given to the command
+	enum class input_mode
+	{
+		// a file next to the original file
+		file,
+
+		// an anonymous file in memory that is opened through /proc
+		memfd,
+
+		// the file is kept in memory and written into the stdin of the command
+		stdin
 	};
 
 	struct opts
 	{
-		std::string command_with_orig_bin;
-		std::string command_with_patched_bin;
+		// the command split into arguments, %c hasn't been substituted yet
+		std::vector<std::string> command_args;
 		std::string original_bin_path;
 		std::string patched_bin_path;
-		u64 section_address;
-		u64 section_size;
+		std::string forkserver_shim_path;
+
+		// findings and checkpoints are stored here if it isn't empty
+		std::string output_dir_path;
+		bool resume{false};
+
+		// a coordinator listens on this address and hands out work to the
+		// workers that connect to it, a worker connects to this address
+		std::string listen_address;
+		std::string connect_address;
+		std::vector<section> sections;
+
+		// fields of the file format that get mutated with boundary values
+		// and checksums that get fixed up after patching
+		std::vector<field> layout;
 		f32 execution_time_variation_multiplier{5.0f};
 		u64 max_bytes_to_change{32};
 		u64 test_run_count{10};
 		u64 seed{0};
+		u64 jobs{1};
+		u64 kill_grace_ms{100};
+		u64 cpu_limit_s{0};
+		u64 memory_limit_mb{0};
+		f32 usage_ratio{4.0f};
+		u64 dedup_memory_mb{16};
+
+		// count instructions, branches and page faults of the command
+		bool perf_counters{false};
+
+		// collect the edges that the command reaches from its coverage runtime
+		bool coverage{false};
+
+		// pick the offsets and lengths of the patches uniformly instead
+		// of based on where the productive patches have been
+		bool uniform_offsets{false};
+
+		// stop the fuzzing after this many executions if it isn't zero
+		u64 max_execs{0};
+
+		// how many times anomalies are run again before they count as findings
+		u64 verify_runs{3};
+
+		// if this isn't zero, every value of a window this wide at every
+		// address of the sections is tried instead of random mutations
+		u64 enumeration_width{0};
 		std::vector<u8> ignored_return_values;
+		fuzz::mutation_weights mutation_weights = default_mutation_weights;
 
 		fuzz::mode mode = mode::continuous;
+		fuzz::input_mode input_mode = input_mode::file;
+		fuzz::time_metric time_metric = time_metric::wall;
+		fuzz::value_order value_order = value_order::interesting_first;
 	};
 
 	opts parse_cli_args(const int argc, char** const argv);
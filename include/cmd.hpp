@@ -2,18 +2,152 @@
 
 #include "types.hpp"
 
-#include <string_view>
+#include <ctime>
+#include <limits>
+#include <span>
+#include <string>
+#include <sys/types.h>
+#include <vector>
 
 namespace fuzz
 {
+	constexpr u64 no_time_limit = std::numeric_limits<u64>::max();
+
+	struct exec_limits
+	{
+		// after this many nanoseconds the process group of the command gets a SIGTERM
+		u64 time_limit_ns{no_time_limit};
+
+		// how long to wait after the SIGTERM before sending a SIGKILL
+		u64 kill_grace_ms{100};
+
+		// RLIMIT_CPU in seconds in case the command manages to dodge
+		// the deadline somehow, zero to not set a limit
+		u64 cpu_limit_s{0};
+
+		// RLIMIT_AS in megabytes so that the command can't eat up all of
+		// the memory of the machine, zero to not set a limit
+		u64 memory_limit_mb{0};
+	};
+
 	struct cmd_res
 	{
-		// shell or command return value from std::system
-		i32 return_value;
+		// exit code of the command, zero if it was killed by a signal
+		i32 return_value{0};
+
+		// the signal that killed the command, zero if it exited normally
+		i32 signal{0};
 
-		// execution time in milliseconds
-		u64 exec_time;
+		// execution time in nanoseconds
+		u64 exec_time{0};
+
+		// how much of the execution time went into starting the command
+		u64 spawn_time{0};
+
+		// time spent applying the patch to the file before the execution,
+		// filled in by the worker
+		u64 patch_time{0};
+
+		// the command was killed because it went over the time limit
+		bool timed_out{false};
+
+		// resource usage of the command (and any children it waited for)
+		// times are in nanoseconds
+		u64 max_rss_kb{0};
+		u64 user_time{0};
+		u64 system_time{0};
+		u64 minor_faults{0};
+		u64 major_faults{0};
+		u64 voluntary_switches{0};
+		u64 involuntary_switches{0};
+
+		// performance counters of the command in user space,
+		// filled in by the worker if they are enabled
+		u64 instructions{0};
+		u64 branches{0};
+		u64 page_faults{0};
+
+		u64 cpu_time() const noexcept { return user_time + system_time; }
 	};
 
-	cmd_res run_cmd(const std::string_view cmd, const u64 execution_time_limit_ms = 1000);
+	// a command that has been split into arguments ahead of time
+	// so that it can be started directly without going through a shell
+	class command
+	{
+	public:
+		command(const std::vector<std::string>& args);
+
+		command(const command& other);
+		command& operator=(const command&) = delete;
+
+		char* const* argv() const noexcept;
+
+	private:
+		std::vector<std::string> args;
+
+		// null terminated list of pointers to the args for execve
+		std::vector<char*> arg_ptrs;
+	};
+
+	// split a command string into arguments like a shell would
+	//
+	// if the command uses any shell features like pipes or redirections,
+	// the whole command is passed to /bin/sh instead
+	std::vector<std::string> split_command(const std::string& cmd);
+
+	// replace %c in the arguments with the given file path
+	command substitute_file_path(const std::vector<std::string>& args, const std::string& path);
+
+	// start the command directly from the fuzzer and wait for it
+	//
+	// if stdin_bytes isn't empty, they are written into a pipe that is
+	// used as the stdin of the command
+	//
+	// if coverage_fd isn't -1, the command gets it as the shared memory
+	// that the coverage runtime writes the hit counts into
+	cmd_res run_cmd(const command& cmd, const exec_limits& limits = {}, const std::span<const u8> stdin_bytes = {}, const i32 coverage_fd = -1);
+
+	// the point in time on the monotonic clock after the given amount of nanoseconds
+	timespec deadline_after(const u64 ns);
+
+	// wait until the file descriptor becomes readable or the deadline passes
+	// returns false if the deadline passed first
+	bool wait_for_fd(const i32 fd, const timespec& deadline);
+
+	// write the bytes into the stdin pipe of a command as fast as the command reads them
+	//
+	// stops early if exit_fd becomes readable, the command closes its
+	// stdin or the deadline passes
+	void feed_stdin(const i32 pipe_fd, const i32 exit_fd, std::span<const u8> bytes, const timespec& deadline, const exec_limits& limits);
+
+	// wait until the fd becomes readable, or if that doesn't happen before
+	// the time limit, kill the whole process group of the process
+	//
+	// the process has to lead its own process group already, and it can't
+	// be reaped before this returns, so that the pid can't get reused by
+	// something that would then be killed instead. the fd should become
+	// readable once the process has exited but before it has been reaped
+	//
+	// if fd is -1, the process is checked on until it exits instead
+	// returns true if the process had to be killed
+	bool wait_or_kill(const pid_t pid, const i32 fd, const timespec& deadline, const exec_limits& limits);
+
+	// the file descriptors of the spawner, the coverage runtime and the
+	// forkserver are fixed and sit right below this one
+	constexpr i32 first_unreserved_fd = 200;
+
+	// a close-on-exec copy of the fd that is above the fixed file descriptors,
+	// or -1 if the fd is -1
+	//
+	// the copies are used as the sources when the fixed file descriptors
+	// are set up for a new process, so that setting up one of them can't
+	// overwrite a source that happened to have the same number
+	i32 dup_above_fixed_fds(const i32 fd);
+
+	// set RLIMIT_CPU and RLIMIT_AS of the calling process, the commands
+	// call this after they have been forked and before they exec
+	void apply_resource_limits(const exec_limits& limits);
+
+	// fill in the return value and the signal from a waitpid status
+	void set_exit_status(cmd_res& res, const i32 status);
 }
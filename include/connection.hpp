@@ -0,0 +1,110 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace fuzz
+{
+	// every message has a header with its type and the size of its payload
+	struct message
+	{
+		u32 type;
+		std::vector<u8> payload;
+	};
+
+	// a stream socket between the coordinator and one of its workers
+	//
+	// addresses are either "<host>:<port>" for tcp, or "unix:<path>" or
+	// any path with a slash in it for a unix socket
+	class connection
+	{
+	public:
+		// connect to the coordinator listening on the address
+		explicit connection(const std::string& address);
+
+		// take over a socket that a listener has accepted
+		explicit connection(const i32 fd);
+		~connection();
+
+		connection(const connection&) = delete;
+		connection& operator=(const connection&) = delete;
+
+		// returns false if the other end has gone away
+		bool send(const u32 type, const std::span<const u8> payload = {});
+
+		// block until a whole message has arrived, returns nullopt if the
+		// other end has gone away or sent something that isn't a message
+		std::optional<message> receive();
+
+		// wake up a receive that is blocking in another thread
+		void shut_down();
+
+	private:
+		bool write_all(const void* buffer, const u64 size);
+		bool read_all(void* buffer, const u64 size);
+
+		const i32 fd;
+	};
+
+	// the socket that the coordinator accepts its workers from
+	class listener
+	{
+	public:
+		explicit listener(const std::string& address);
+		~listener();
+
+		listener(const listener&) = delete;
+		listener& operator=(const listener&) = delete;
+
+		// wait for at most timeout_ms for a worker to connect, returns
+		// the socket of the connection or -1 if nothing connected
+		i32 accept(const u64 timeout_ms);
+
+	private:
+		i32 fd;
+
+		// the socket file of a unix socket gets removed when the listener closes
+		std::string unix_path;
+	};
+
+	// the payloads are sequences of 64-bit values and strings of bytes in the
+	// byte order of the machine, so the coordinator and the workers need to
+	// run on machines with the same byte order. the join message starts with
+	// a magic number that catches the case where they don't
+	class message_writer
+	{
+	public:
+		message_writer& put(const u64 value);
+		message_writer& put_bytes(const std::span<const u8> bytes);
+		message_writer& put_values(const std::span<const u64> values);
+
+		const std::vector<u8>& bytes() const noexcept;
+
+	private:
+		std::vector<u8> buffer;
+	};
+
+	class message_reader
+	{
+	public:
+		explicit message_reader(const std::span<const u8> payload);
+
+		// reading past the end of the payload gives zeros and empty
+		// vectors, after which the reader is no longer good
+		u64 get();
+		std::vector<u8> get_bytes();
+		std::vector<u64> get_values();
+
+		// true if everything was read without going past the end
+		bool good() const noexcept;
+
+	private:
+		const std::span<const u8> payload;
+		u64 offset{0};
+		bool valid{true};
+	};
+}
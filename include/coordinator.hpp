@@ -0,0 +1,95 @@
+#pragma once
+
+#include "connection.hpp"
+#include "coordinator_protocol.hpp"
+#include "fingerprint_set.hpp"
+#include "output_dir.hpp"
+#include "types.hpp"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fuzz
+{
+	// hands out work units to the workers of a distributed campaign and
+	// collects their findings and statistics
+	//
+	// the coordinator does the dry runs once and every worker gets the same
+	// baselines and seed. the units are ranges that are never handed out
+	// twice, so the workers don't repeat each others patches, and the
+	// findings are deduplicated before they reach the callback
+	//
+	// each worker is served by a thread of its own
+	class coordinator
+	{
+	public:
+		using finding_fn = std::function<void(const coordinator_protocol::finding_record&)>;
+		using report_fn = std::function<void(const coordinator_protocol::unit_report&)>;
+
+		// units are handed out from first_unit onwards, and if unit_limit isn't
+		// zero, only up to it. the units have unit_batches batches of
+		// patches for each job that a worker has
+		//
+		// the callbacks are never called at the same time as each other
+		coordinator(const std::string& address, const coordinator_protocol::campaign& c, const checkpoint& baseline,
+			const u64 first_unit, const u64 unit_limit, const u64 unit_batches,
+			const finding_fn& on_finding, const report_fn& on_report);
+		~coordinator();
+
+		coordinator(const coordinator&) = delete;
+		coordinator& operator=(const coordinator&) = delete;
+
+		// accept the workers that connect within timeout_ms
+		void poll(const u64 timeout_ms);
+
+		// stop handing out units, the workers stop after their current one
+		void stop();
+
+		// true once no more units are handed out and every worker has left
+		bool finished();
+
+		u64 worker_count();
+
+		// the end of the units handed out so far
+		u64 next_unit() const noexcept;
+
+	private:
+		struct session
+		{
+			std::unique_ptr<connection> conn;
+			std::thread thread;
+			std::atomic<bool> done{false};
+		};
+
+		void serve(session& s);
+
+		// handle a message of a worker, returns false if the worker should be dropped
+		bool handle(connection& conn, const message& msg);
+
+		// join the threads of the workers that have left
+		void reap_sessions();
+
+		listener socket;
+		const coordinator_protocol::campaign campaign;
+		const std::vector<u8> baseline_payload;
+		const u64 unit_limit;
+		const u64 unit_batches;
+		const finding_fn on_finding;
+		const report_fn on_report;
+
+		std::mutex sessions_mutex;
+		std::vector<std::unique_ptr<session>> sessions;
+
+		// the unit counter, the findings and the minimization claim
+		std::mutex state_mutex;
+		std::atomic<u64> next_first;
+		std::atomic<bool> stopping{false};
+		bool minimization_claimed{false};
+		fingerprint_set findings;
+	};
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "connection.hpp"
+#include "coordinator_protocol.hpp"
+#include "output_dir.hpp"
+#include "types.hpp"
+
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+
+namespace fuzz
+{
+	// the connection of a worker to the coordinator of a distributed campaign
+	//
+	// a lost connection is treated as if the coordinator had run out of
+	// work, so the worker stops cleanly and keeps whatever it has found
+	class coordinator_client
+	{
+	public:
+		explicit coordinator_client(const std::string& address);
+
+		// join the campaign and get the seed and the baselines of the
+		// coordinator, exits with an error if the worker gets turned away
+		checkpoint join(const coordinator_protocol::campaign& c);
+
+		// the next unit of work for a worker with the given amount of jobs,
+		// nullopt once the coordinator has no more work to hand out
+		std::optional<coordinator_protocol::work_unit> request_unit(const u64 jobs);
+
+		void send_report(const coordinator_protocol::unit_report& r);
+
+		// this is safe to call from multiple workers at the same time
+		void send_finding(const coordinator_protocol::finding_record& f);
+
+		// returns true if this worker gets to minimize its finding
+		bool claim_minimization();
+
+	private:
+		// send a request and wait for the reply to it
+		std::optional<message> request(const u32 type, const std::span<const u8> payload = {});
+
+		connection conn;
+		std::mutex mutex;
+		bool connected{true};
+	};
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "anomaly.hpp"
+#include "cmd.hpp"
+#include "output_dir.hpp"
+#include "patch.hpp"
+#include "types.hpp"
+
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace fuzz::coordinator_protocol
+{
+	// the join message starts with these, workers of a different
+	// version or with a different byte order get turned away
+	constexpr u64 hello = 0x444f5343;
+	constexpr u64 version = 1;
+
+	// every request of a worker that expects a reply gets exactly one,
+	// the rest of the messages are one way
+	enum message_type : u32
+	{
+		// worker: hello, version and the campaign
+		join,
+
+		// coordinator: the baselines as a checkpoint, the reply to a join
+		baseline,
+
+		// coordinator: why the worker was turned away, the reply to a join
+		rejected,
+
+		// worker: asks for more work, has the job count of the worker
+		request_unit,
+
+		// coordinator: the next work unit, the reply to a unit request
+		unit,
+
+		// coordinator: there is no more work, the reply to a unit request
+		stop,
+
+		// worker: the stats of the executions since the last report
+		report,
+
+		// worker: a verified finding
+		finding,
+
+		// worker: asks to minimize the finding it stopped at
+		claim_minimization,
+
+		// coordinator: whether the worker got to minimize, the reply to a claim
+		claim_result
+	};
+
+	// the settings that the coordinator and the workers need to agree on
+	struct campaign
+	{
+		u64 file_fingerprint;
+		u64 sections_fingerprint;
+		u64 mode;
+		u64 enumeration_width;
+		u64 value_order;
+
+		bool operator==(const campaign&) const = default;
+	};
+
+	// a range of work that only the worker it was given to does
+	//
+	// with random mutations, the random number generators of the worker get
+	// reseeded from the first index and count is the amount of patches to
+	// run. with --enumerate, the range has the indices of the candidates
+	struct work_unit
+	{
+		u64 first;
+		u64 count;
+	};
+
+	// what a worker did since its last report
+	struct unit_report
+	{
+		u64 executions;
+		std::vector<u64> section_executions;
+		std::vector<u64> section_anomalies;
+
+		// the address statistics, see hotness_map::sparse_counts()
+		std::vector<u64> hotness;
+	};
+
+	struct finding_record
+	{
+		patch p;
+		cmd_res res;
+		anomaly kind;
+		verification v;
+		bool time_result;
+		bool ret_result;
+		bool mem_result;
+
+		// the result of the minimization rather than an anomaly that came up while fuzzing
+		bool minimized;
+	};
+
+	std::vector<u8> encode(const campaign& c);
+	std::vector<u8> encode(const checkpoint& c);
+	std::vector<u8> encode(const work_unit& w);
+	std::vector<u8> encode(const unit_report& r);
+	std::vector<u8> encode(const finding_record& f);
+
+	// the decoders return nullopt if the payload is malformed
+	std::optional<campaign> decode_campaign(const std::span<const u8> payload);
+	std::optional<checkpoint> decode_checkpoint(const std::span<const u8> payload);
+	std::optional<work_unit> decode_work_unit(const std::span<const u8> payload);
+	std::optional<unit_report> decode_unit_report(const std::span<const u8> payload);
+	std::optional<finding_record> decode_finding_record(const std::span<const u8> payload);
+}
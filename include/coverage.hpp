@@ -0,0 +1,103 @@
+#pragma once
+
+#include "coverage_protocol.hpp"
+#include "patch.hpp"
+#include "rng.hpp"
+#include "types.hpp"
+
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <span>
+#include <vector>
+
+namespace fuzz
+{
+	// the hit counts of the edges of a single run, in shared memory
+	// that the coverage runtime in the target writes into
+	class coverage_map
+	{
+	public:
+		coverage_map();
+		~coverage_map();
+
+		coverage_map(const coverage_map&) = delete;
+		coverage_map& operator=(const coverage_map&) = delete;
+
+		// the command gets this as the coverage fd of the protocol
+		i32 file_descriptor() const noexcept;
+
+		// zero the counters before a run
+		void clear();
+
+		std::span<const u8> counters() const noexcept;
+
+	private:
+		i32 fd;
+		u8* data;
+	};
+
+	// every edge and hit count bucket that any of the runs have reached
+	//
+	// the hit counts are put into buckets like 1, 2, 3, 4-7, 8-15 and so on,
+	// so that a loop that runs a few more times doesn't count as new coverage
+	// but one that runs an order of magnitude more does
+	class coverage
+	{
+	public:
+		coverage();
+
+		// add the edges of a run, returns true if the run reached an edge or
+		// a hit count bucket that no run before it had reached
+		//
+		// empty cache lines of the counters are skipped with a single vector
+		// check, and only the 16 byte chunks that aren't empty get put into
+		// buckets, so a run that only reached a few hundred edges costs
+		// a few microseconds
+		//
+		// this is safe to call from multiple workers at the same time
+		bool merge(const std::span<const u8> counters);
+
+		u64 edge_count() const noexcept;
+
+	private:
+		// one bit for each bucket of each edge that has been reached
+		std::unique_ptr<std::atomic<u64>[]> seen;
+		std::atomic<u64> edges{0};
+	};
+
+	// a patch that reached new coverage and the section it was made for
+	struct seed
+	{
+		patch p;
+		u64 section_index;
+	};
+
+	// patches that reached new coverage, new patches get built on top of
+	// them so that the fuzzing keeps going deeper into the parser
+	//
+	// once the pool is full, new seeds replace the oldest ones
+	class seed_pool
+	{
+	public:
+		explicit seed_pool(const u64 capacity);
+
+		// this is safe to call from multiple workers at the same time
+		void add(const patch& p, const u64 section_index);
+
+		// a random seed, nothing if there aren't any yet
+		//
+		// this is safe to call from multiple workers at the same time
+		std::optional<seed> pick(rng& r) const;
+
+		u64 size() const;
+
+	private:
+		const u64 capacity;
+
+		mutable std::shared_mutex mutex;
+		std::vector<seed> seeds;
+		u64 next_index{0};
+	};
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+// this header is shared with the coverage runtime, so it shouldn't
+// include anything that the runtime wouldn't want to link against
+
+namespace fuzz::coverage_protocol
+{
+	// file descriptor of the shared memory that the runtime maps the
+	// hit counts of the edges into, right below the forkserver pipes
+	constexpr int coverage_fd = 197;
+
+	// environment variable that tells the runtime that the fuzzer
+	// has set up the shared memory for it
+	constexpr char enable_env[] = "DOS_FUZZER_COVERAGE";
+
+	// the amount of 8-bit hit counters, edges get hashed into these
+	// so the size needs to be a power of two
+	constexpr unsigned long map_size = 1 << 16;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "patch.hpp"
+#include "section.hpp"
+#include "types.hpp"
+
+#include <array>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace fuzz
+{
+	// the widest window that can be enumerated, 256^3 values
+	// at every address is already a lot of executions
+	constexpr u64 max_enumeration_width = 3;
+
+	// the order that the values of each byte are tried in
+	enum class value_order
+	{
+		// 0x00, 0x01, ..., 0xff
+		sequential,
+
+		// the values that are likely to hit edge cases in parsers
+		// first and the rest of them after that
+		interesting_first
+	};
+
+	// goes through every combination of values of a window of 1-3 bytes
+	// at every address of the sections, with a window of 1 byte this is
+	// a sweep of every value of a single byte over the sections
+	//
+	// the candidates are numbered so that the workers can take them from
+	// a shared counter. the values are the outer loop and the addresses
+	// the inner one, so the values that come first in the value order
+	// get tried at every address before the rest of the values
+	class enumerator
+	{
+	public:
+		enumerator(const std::span<const u8> orig_bytes, const std::vector<section>& sections, const u64 width, const value_order order);
+
+		// the amount of candidates, including the ones that would
+		// leave the original bytes as they are
+		u64 size() const noexcept;
+
+		// the candidate with the given number, nothing if the
+		// candidate has the same bytes as the original file
+		std::optional<patch> candidate(const u64 index) const;
+
+		// the index of the section that the candidate is in
+		u64 section_index(const u64 index) const;
+
+	private:
+		// the address of the window the candidate is at
+		u64 window_address(const u64 index) const;
+
+		const std::span<const u8> orig_bytes;
+		const std::vector<section> sections;
+		const u64 width;
+
+		// the amount of windows in each section and all of the
+		// sections before it
+		std::vector<u64> cumulative_windows;
+		u64 window_count{0};
+		u64 value_count{1};
+
+		std::array<u8, 256> values;
+	};
+}
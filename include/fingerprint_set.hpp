@@ -0,0 +1,54 @@
+#pragma once
+
+#include "patch.hpp"
+#include "types.hpp"
+
+#include <atomic>
+#include <span>
+#include <vector>
+
+namespace fuzz
+{
+	// 64-bit hash of a key and a string of bytes that can be used
+	// in place of the bytes themselves when checking for duplicates
+	//
+	// zero is never returned since the fingerprint set uses it for empty slots
+	u64 fingerprint(const u64 key, const std::span<const u8> bytes) noexcept;
+	u64 fingerprint(const patch& p) noexcept;
+
+	// set of fingerprints in a flat open addressing table with a fixed size
+	//
+	// the table is allocated once based on the memory limit, so inserting
+	// and looking up fingerprints never allocates anything. once the table
+	// is full, new fingerprints are no longer remembered
+	class fingerprint_set
+	{
+	public:
+		explicit fingerprint_set(const u64 memory_limit_bytes);
+
+		// returns true if the fingerprint wasn't in the set yet
+		//
+		// this is safe to call from multiple workers at the same time
+		bool insert(const u64 fingerprint) noexcept;
+
+		bool contains(const u64 fingerprint) const noexcept;
+
+		// all of the fingerprints in the set, used for checkpointing
+		//
+		// fingerprints that get inserted while this is running
+		// may or may not end up in the result
+		std::vector<u64> fingerprints() const;
+
+		u64 size() const noexcept;
+		bool is_full() const noexcept;
+
+	private:
+		std::vector<std::atomic<u64>> slots;
+		const u64 mask;
+
+		// the table is considered full well before every slot has been
+		// taken to keep the probe sequences short
+		const u64 max_size;
+		std::atomic<u64> count{0};
+	};
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "cmd.hpp"
+#include "types.hpp"
+
+#include <string>
+#include <sys/types.h>
+
+namespace fuzz
+{
+	// a target process that has the forkserver shim preloaded and
+	// forks a new copy of itself right before main for each run
+	class forkserver
+	{
+	public:
+		// if stdin_fd isn't -1, it is used as the stdin of the forkserver and
+		// rewound before each run so that every child reads it from the start
+		//
+		// if coverage_fd isn't -1, the children get it as the shared memory
+		// of the coverage runtime
+		forkserver(const command& cmd, const std::string& shim_path, const i32 stdin_fd = -1, const i32 coverage_fd = -1);
+		~forkserver();
+
+		forkserver(const forkserver&) = delete;
+		forkserver& operator=(const forkserver&) = delete;
+
+		cmd_res run(const exec_limits& limits);
+
+	private:
+		void read_exact(void* buffer, const u64 size);
+		u32 read_status();
+
+		pid_t pid;
+		const i32 stdin_fd;
+		i32 control_fd;
+		i32 status_fd;
+	};
+}
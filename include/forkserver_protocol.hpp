@@ -0,0 +1,51 @@
+#pragma once
+
+// this header is shared with the forkserver shim library, so it
+// shouldn't include anything that the shim wouldn't want to link against
+
+namespace fuzz::forkserver_protocol
+{
+	// file descriptors that the forkserver reads requests from and
+	// writes statuses to, these are the same as the ones used by AFL
+	constexpr int control_fd = 198;
+	constexpr int status_fd = 199;
+
+	// environment variable that tells the shim to start a forkserver
+	constexpr char enable_env[] = "DOS_FUZZER_FORKSERVER";
+
+	// the messages over the pipes are single 32-bit values unless noted otherwise
+	//
+	// handshake: the shim writes a hello message when it is ready
+	// for each run: the fuzzer writes a run request and the limits of the run,
+	// the shim writes the pid of the child and an exit message once the child
+	// has exited, the fuzzer writes a reap request when it's done signalling
+	// the process group of the child, and the shim writes the wait status
+	// of the child and its usage after reaping it
+	//
+	// the child is only reaped after the reap request so that its pid
+	// can't be reused while the fuzzer might still signal it
+	constexpr unsigned int hello = 0x444f5346;
+	constexpr unsigned int run_request = 1;
+	constexpr unsigned int child_exited = 2;
+	constexpr unsigned int reap_request = 3;
+
+	// resource limits that the child sets before it continues to main,
+	// zero means no limit
+	struct run_limits
+	{
+		unsigned long long cpu_limit_s;
+		unsigned long long memory_limit_mb;
+	};
+
+	// resource usage of the child from wait4, times are in microseconds
+	struct child_usage
+	{
+		unsigned long long max_rss_kb;
+		unsigned long long user_time_us;
+		unsigned long long system_time_us;
+		unsigned long long minor_faults;
+		unsigned long long major_faults;
+		unsigned long long voluntary_switches;
+		unsigned long long involuntary_switches;
+	};
+}
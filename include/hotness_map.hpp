@@ -0,0 +1,98 @@
+#pragma once
+
+#include "patch.hpp"
+#include "rng.hpp"
+#include "section.hpp"
+#include "types.hpp"
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace fuzz
+{
+	// how productive the patches at each part of the file have been
+	//
+	// the file is split into blocks of a power of two bytes, small enough
+	// that the blocks of a file header are a few bytes each but big enough
+	// that the stats of a large binary still fit into a compact array.
+	// every execution is credited to the blocks whose bytes the patch
+	// changed, and the same is done for the length of the patch
+	//
+	// the stats drive the start offsets and the lengths of new patches: a
+	// few random start offsets are drawn and the one in the block with the
+	// best estimated rate of productive runs wins. blocks that haven't been
+	// tried yet are estimated to be as productive as the average, so the
+	// sampler keeps exploring while it spends most of the executions on
+	// the blocks that keep producing something
+	class hotness_map
+	{
+	public:
+		hotness_map(const std::span<const u8> orig_bytes);
+
+		// record a run of the patch, productive means that the run caused an
+		// anomaly or reached something new, slow means that the command was
+		// noticeably slower than normal and cost_delta is how much the cost of
+		// the run differed from the normal cost
+		//
+		// this is safe to call from multiple workers at the same time
+		void record(const patch& p, const bool productive, const bool slow, const i64 cost_delta);
+
+		// a start offset for a patch of the given size within the section
+		//
+		// this is safe to call from multiple workers at the same time
+		u64 pick_start(rng& r, const section& s, const u64 size) const;
+
+		// a patch length in [1, max_size]
+		//
+		// this is safe to call from multiple workers at the same time
+		u64 pick_size(rng& r, const u64 max_size) const;
+
+		// the stats of every block that has been patched as tab separated values
+		std::string to_tsv() const;
+
+		// the stats of the blocks and the patch lengths that have been run as
+		// tuples of an index, the executions, the productive runs, the slow
+		// runs and the sum of the cost deltas, so that the stats of the workers
+		// of a distributed campaign can be merged on the coordinator
+		std::vector<u64> sparse_counts() const;
+
+		// add the counts from sparse_counts() of a map of the same file,
+		// tuples that don't fit the map are ignored
+		//
+		// this is safe to call from multiple workers at the same time
+		void merge(const std::span<const u64> counts);
+
+		// forget everything, this must not be called at the same time as anything else
+		void clear();
+
+	private:
+		struct block_stats
+		{
+			std::atomic<u64> executions{0};
+			std::atomic<u64> productive{0};
+			std::atomic<u64> slow{0};
+			std::atomic<i64> cost_delta_sum{0};
+		};
+
+		// patch lengths are grouped by powers of two: 1, 2, 3-4, 5-8, ...
+		static constexpr u64 size_class_count = 8;
+
+		// the estimated rate of productive runs, shrunk towards the average
+		// rate of all of the runs when there are only a few runs to go by
+		f64 estimate(const block_stats& stats) const;
+
+		const std::span<const u8> orig_bytes;
+		u64 block_shift{0};
+		u64 block_count;
+
+		std::unique_ptr<block_stats[]> blocks;
+		std::array<block_stats, size_class_count> size_classes;
+
+		std::atomic<u64> total_executions{0};
+		std::atomic<u64> total_productive{0};
+	};
+}
@@ -1,19 +1,25 @@
 #pragma once
 
 #include "cmd.hpp"
+#include "patch.hpp"
 #include "types.hpp"
 
 #include <filesystem>
+#include <string>
 #include <vector>
 
 namespace fuzz
 {
 	std::vector<u8> read_bytes(const std::filesystem::path& path);
-	void write_bytes(const std::filesystem::path path, std::vector<u8>& bytes);
 	void print_spinner();
 	void clear_cli_line();
 
-	void print_result(const u64 address, const u64 byte_count, const std::vector<u8>& bytes, const cmd_res res);
+	// format a duration in nanoseconds as milliseconds
+	std::string format_duration(const u64 ns);
+
+	// if print_usage is true, the peak memory usage and the cpu time are printed too,
+	// a non-empty note gets a column of its own before the bytes
+	void print_result(const patch& p, const cmd_res res, const bool print_usage = false, const std::string& note = "");
 
 	__attribute__((noreturn, cold))
 	void fatal_error(const std::string& error_msg);
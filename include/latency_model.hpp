@@ -0,0 +1,54 @@
+#pragma once
+
+#include "sample_window.hpp"
+#include "types.hpp"
+
+namespace fuzz
+{
+	// distribution of the normal execution times of the command
+	//
+	// the execution time limit is derived from the distribution instead of
+	// the longest execution time, so that a single slow run or a command that
+	// is too fast to measure in milliseconds doesn't throw the limit off
+	class latency_model
+	{
+	public:
+		// the margin on top of the p99 is never less than min_margin_ns or
+		// min_margin_of_median times the median, which should cover the
+		// jitter that the clock and the scheduler cause
+		latency_model(const f32 variation_multiplier, const u64 min_margin_ns = default_min_margin_ns, const f64 min_margin_of_median = default_min_margin_of_median);
+
+		static constexpr u64 default_min_margin_ns = 1'000'000;
+		static constexpr f64 default_min_margin_of_median = 0.25;
+
+		// add the execution time of a run that didn't have anything abnormal about it
+		//
+		// this is safe to call from multiple workers at the same time
+		void add_sample(const u64 exec_time_ns);
+
+		u64 median() const noexcept;
+		u64 p99() const noexcept;
+
+		// median absolute deviation from the median
+		u64 mad() const noexcept;
+
+		// the execution times in the window, used for checkpointing
+		std::vector<u64> samples_snapshot() const;
+
+		// runs that take longer than this are considered abnormally slow
+		u64 execution_time_limit() const noexcept;
+
+		// runs that take longer than this are clearly slower than most
+		// normal runs, but not necessarily abnormally slow
+		//
+		// the limit only depends on the median and the MAD, so it stays
+		// close to the normal execution time even if the p99 is far off
+		u64 early_abort_limit() const noexcept;
+
+	private:
+		const f32 variation_multiplier;
+		const u64 min_margin_ns;
+		const f64 min_margin_of_median;
+		sample_window samples;
+	};
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <array>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace fuzz
+{
+	// what the value of a field in the file is used for
+	enum class field_type
+	{
+		// the size of something in bytes
+		length,
+
+		// the amount of items in something
+		count,
+
+		// the position of something in the file
+		offset,
+
+		// any other integer
+		integer,
+
+		// checksums of a range of the file, they get recalculated after
+		// patching instead of being mutated
+		crc32,
+		adler32,
+
+		field_type_count
+	};
+
+	// names used for the field types in the layout file
+	constexpr std::array<const char*, static_cast<u64>(field_type::field_type_count)> field_type_names = {
+		"length", "count", "offset", "integer", "crc32", "adler32"
+	};
+
+	// an integer field at a fixed position in the file
+	struct field
+	{
+		u64 address;
+		u64 width;
+		bool big_endian;
+		field_type type;
+
+		// the range of the file that a checksum is calculated over
+		u64 checksum_address{0};
+		u64 checksum_size{0};
+
+		u64 end_address() const noexcept { return address + width; }
+		bool is_checksum() const noexcept { return type == field_type::crc32 || type == field_type::adler32; }
+
+		// the largest value that fits into the field
+		u64 max_value() const noexcept { return width == 8 ? ~0ull : (1ull << (width * 8)) - 1; }
+	};
+
+	// read the fields from a layout file that describes a field on each line
+	// with the hexadecimal address, the width in bytes, the endianness (le or be)
+	// and the type of the field, for example "1c 4 le length". checksums are
+	// followed by the hexadecimal address and size of the range they cover
+	//
+	// empty lines and lines starting with # are skipped
+	std::vector<field> read_layout_file(const std::string& path, const u64 file_size);
+
+	u64 read_field(const field& f, const std::span<const u8> bytes);
+	void write_field(const field& f, const std::span<u8> bytes, const u64 value);
+
+	// calculate the checksum of the field over the bytes of the file
+	u64 calculate_checksum(const field& f, const std::span<const u8> file_bytes);
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "patch.hpp"
+#include "types.hpp"
+
+#include <functional>
+#include <span>
+#include <vector>
+
+namespace fuzz
+{
+	// runs a batch of candidate patches and tells which of them
+	// reproduced the anomaly that is being minimized
+	using batch_test_fn = std::function<std::vector<bool>(const std::vector<patch>&)>;
+
+	// find a minimal set of changed bytes in the patch that still reproduces the anomaly
+	//
+	// the minimization is done with delta debugging (ddmin): the changed bytes
+	// are split into subsets and the subsets and their complements are tested
+	// with the rest of the bytes reverted back to the original ones. the patched
+	// values are never changed, so the result is deterministic and takes
+	// O(k log n) test runs for k relevant bytes out of n changed bytes
+	//
+	// the returned patch is 1-minimal, i.e. reverting any single one of its
+	// changed bytes makes the anomaly go away
+	patch minimize_patch(const patch& p, const std::span<const u8> orig_bytes, const batch_test_fn& test);
+
+	// offsets of the bytes in the patch that differ from the original bytes
+	std::vector<u64> changed_offsets(const patch& p, const std::span<const u8> orig_bytes);
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "hotness_map.hpp"
+#include "layout.hpp"
+#include "patch.hpp"
+#include "rng.hpp"
+#include "section.hpp"
+#include "types.hpp"
+
+#include <array>
+#include <shared_mutex>
+#include <span>
+#include <vector>
+
+namespace fuzz
+{
+	// the different ways of coming up with new patches
+	//
+	// a patch always replaces the same amount of bytes that it covers, so
+	// block deletions and insertions are done by shifting the bytes within
+	// the patched area instead of changing the size of the file
+	enum mutation
+	{
+		// overwrite a range with random bytes
+		random_bytes,
+
+		// flip a few random bits
+		bit_flip,
+
+		// add or subtract a small number from an 8, 16, 32 or 64-bit integer
+		arithmetic,
+
+		// overwrite an integer with a value that is likely to cause trouble,
+		// like zero, the max value or something that looks like a length
+		interesting,
+
+		// duplicate a block from somewhere else in the file over a range
+		block_copy,
+
+		// shift the bytes of a range as if some bytes had been deleted or inserted
+		block_shift,
+
+		// combine a patch that caused an anomaly before with random bytes
+		splice,
+
+		// overwrite a field from the layout with a boundary value
+		// based on what the field is used for
+		layout_field,
+
+		mutation_count
+	};
+
+	// names used for selecting the mutations from the command line
+	constexpr std::array<const char*, mutation_count> mutation_names = {
+		"random", "bitflip", "arith", "interesting", "copy", "shift", "splice", "field"
+	};
+
+	// how often each of the mutations gets picked relative to each other
+	using mutation_weights = std::array<u32, mutation_count>;
+	//
+	// the field mutation only gets used if there is a layout
+	constexpr mutation_weights default_mutation_weights = { 4, 1, 1, 2, 1, 1, 1, 8 };
+
+	class mutator
+	{
+	public:
+		// if the hotness map isn't null, the start offsets and the lengths of
+		// the patches are picked based on it instead of uniformly
+		mutator(const std::span<const u8> orig_bytes, const u64 max_bytes_to_change, const mutation_weights& weights, const std::vector<field>& layout = {}, const hotness_map* hotness = nullptr);
+
+		// overwrite the patch with a new mutation of the given section
+		//
+		// the byte buffer of the patch is reused, so a patch that gets passed
+		// in over and over again doesn't allocate after it has grown big enough
+		//
+		// this is safe to call from multiple workers at the same time
+		// as long as each of them uses their own random number generator
+		void mutate(patch& p, rng& r, const section& s) const;
+
+		// overwrite the patch with a new mutation that builds on top of the
+		// parent patch, which needs to be within the given section
+		//
+		// the mutation is done on the original bytes like any other, after
+		// which the bytes it changed are laid over the parent patch
+		//
+		// this is safe to call from multiple workers at the same time
+		// as long as each of them uses their own random number generator
+		void mutate_from(const patch& parent, patch& p, rng& r, const section& s) const;
+
+		// patches that caused an anomaly get used for splicing
+		//
+		// this is safe to call from multiple workers at the same time
+		void add_to_corpus(const patch& p);
+
+	private:
+		mutation pick_mutation(rng& r) const;
+
+		// pick a random range of the given size from the section and
+		// fill the patch with the original bytes from there
+		void pick_range(patch& p, rng& r, const section& s, const u64 size) const;
+
+		// the amount of bytes to change gets truncated to the section size
+		u64 max_bytes(const section& s) const noexcept;
+
+		// the amount of bytes to change for the mutations that aren't
+		// restricted to the widths of integers
+		u64 pick_size(rng& r, const section& s) const;
+
+		void mutate_random_bytes(patch& p, rng& r, const section& s) const;
+		void mutate_bit_flip(patch& p, rng& r, const section& s) const;
+		void mutate_arithmetic(patch& p, rng& r, const section& s) const;
+		void mutate_interesting(patch& p, rng& r, const section& s) const;
+		void mutate_block_copy(patch& p, rng& r, const section& s) const;
+		void mutate_block_shift(patch& p, rng& r, const section& s) const;
+		void mutate_splice(patch& p, rng& r, const section& s) const;
+		void mutate_field(patch& p, rng& r, const section& s) const;
+
+		const std::span<const u8> orig_bytes;
+		const u64 max_bytes_to_change;
+		const hotness_map* const hotness;
+
+		// the fields of the layout that can be mutated, checksums
+		// get fixed up instead
+		std::vector<field> fields;
+
+		// the mutation is picked by finding the first cumulative
+		// weight that is higher than a random number
+		std::array<u64, mutation_count> cumulative_weights;
+
+		mutable std::shared_mutex corpus_mutex;
+		std::vector<patch> corpus;
+		u64 next_corpus_index{0};
+	};
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "anomaly.hpp"
+#include "cmd.hpp"
+#include "patch.hpp"
+#include "types.hpp"
+
+#include <atomic>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace fuzz
+{
+	// everything needed for continuing a campaign where it was left off
+	struct checkpoint
+	{
+		// the checkpoint is only valid for the same file and sections
+		u64 file_fingerprint;
+		u64 sections_fingerprint;
+
+		u64 seed;
+		u64 execution_count;
+
+		// the baselines, so that the dry runs don't need to be repeated
+		std::vector<u64> exec_time_samples;
+		std::vector<u64> max_rss_kb_samples;
+		std::vector<u64> cpu_time_samples;
+		std::vector<u64> instruction_samples;
+
+		// the outcomes of each section so that the scheduler keeps its weights
+		std::vector<u64> section_executions;
+		std::vector<u64> section_anomalies;
+	};
+
+	// directory for the results of a campaign
+	//
+	// every anomaly is stored as a patch record in the findings directory and
+	// the state of the campaign is stored in a checkpoint that --resume
+	// can continue from
+	//
+	// the layout of the directory:
+	//   findings/<kind>-<hash>    a patch record of each unique finding, the kind is
+	//                             hang, sig<n>, ret<n>, mem or slow
+	//   checkpoint                seed, execution count and the baselines
+	//   tried                     fingerprints of the patches that have been tried
+	//   fuzzer_stats.json         execution speed, anomaly counts and a timing breakdown
+	//   slowdown_curve.tsv        every new slowest patch of the slowdown mode
+	//   heatmap.tsv               executions and anomalies at each part of the file
+	class output_dir
+	{
+	public:
+		explicit output_dir(const std::filesystem::path& path);
+
+		// store the patch as a finding unless the same patch with the same
+		// kind of a result has already been stored, returns true if
+		// the finding was new
+		//
+		// if the finding was verified, the anomaly and the amount of
+		// reproductions are stored with it
+		//
+		// this is safe to call from multiple workers at the same time
+		bool save_finding(const patch& p, const cmd_res& res, const anomaly kind = anomaly::none, const verification& v = {});
+
+		// the checkpoint and the fingerprints are written into temporary files
+		// that replace the old ones, so a crash in the middle of writing them
+		// leaves the previous checkpoint intact
+		void save_checkpoint(const checkpoint& c, const std::span<const u64> tried_fingerprints) const;
+
+		std::optional<checkpoint> load_checkpoint() const;
+		std::vector<u64> load_tried_fingerprints() const;
+
+		// the status file gets rewritten every now and then while fuzzing
+		void save_stats(const std::string& json) const;
+
+		// the amplification curve of the slowdown mode as tab separated values
+		void save_slowdown_curve(const std::string& tsv) const;
+
+		// the stats of each part of the file as tab separated values
+		void save_heatmap(const std::string& tsv) const;
+
+		u64 finding_count() const noexcept;
+
+	private:
+		const std::filesystem::path path;
+		const std::filesystem::path findings_path;
+
+		std::mutex findings_mutex;
+		std::atomic<u64> findings{0};
+	};
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <vector>
+
+namespace fuzz
+{
+	// a contiguous string of bytes that replaces the original
+	// bytes of the file starting from the given address
+	struct patch
+	{
+		u64 address;
+		std::vector<u8> bytes;
+
+		u64 end_address() const noexcept { return address + bytes.size(); }
+	};
+}
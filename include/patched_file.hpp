@@ -0,0 +1,50 @@
+#pragma once
+
+#include "args.hpp"
+#include "layout.hpp"
+#include "patch.hpp"
+#include "types.hpp"
+
+#include <span>
+#include <string>
+#include <vector>
+
+namespace fuzz
+{
+	// a copy of the original file that is kept mapped into memory
+	//
+	// applying a patch only touches the bytes of the previous patch and
+	// the new one, so the cost of a run doesn't depend on the file size
+	class patched_file
+	{
+	public:
+		patched_file(const std::string& file_path, const std::vector<u8>& orig_bytes, const input_mode mode);
+		~patched_file();
+
+		patched_file(const patched_file&) = delete;
+		patched_file& operator=(const patched_file&) = delete;
+
+		// restore the bytes of the previous patch and apply the new one
+		void apply(const patch& p);
+
+		// recalculate the checksums that cover the bytes of the current patch,
+		// the checksum fields get restored together with the patch
+		void fix_checksums(const std::span<const field> checksums);
+
+		// the path that the command should use for opening the file
+		const std::string& path() const noexcept;
+
+		std::span<const u8> bytes() const noexcept;
+		i32 file_descriptor() const noexcept;
+
+	private:
+		const std::vector<u8>& orig_bytes;
+
+		i32 fd;
+		u8* data;
+		std::string file_path;
+
+		u64 prev_address{0};
+		u64 prev_size{0};
+	};
+}
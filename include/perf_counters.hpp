@@ -0,0 +1,48 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <string>
+
+namespace fuzz
+{
+	// hardware and software performance counters of the calling thread
+	// and every process that it starts after the counters were opened
+	//
+	// the counts of a child process get added to the counters when it exits,
+	// so the difference between two reads is how much the processes that
+	// exited in between did, plus the little that the thread itself did
+	//
+	// only user space is counted, which doesn't need any privileges with
+	// the default perf_event_paranoid setting
+	class perf_counters
+	{
+	public:
+		struct values
+		{
+			u64 instructions{0};
+			u64 branches{0};
+			u64 page_faults{0};
+		};
+
+		// counters that can't be opened read as zero
+		perf_counters();
+		~perf_counters();
+
+		perf_counters(const perf_counters&) = delete;
+		perf_counters& operator=(const perf_counters&) = delete;
+
+		values read() const;
+
+		// check if retired instructions can be counted on this machine, virtual
+		// machines often don't expose the hardware counters to the guest
+		//
+		// returns an empty string if they can, otherwise the reason why not
+		static std::string instructions_unavailable_reason();
+
+	private:
+		i32 instructions_fd;
+		i32 branches_fd;
+		i32 page_faults_fd;
+	};
+}
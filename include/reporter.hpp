@@ -0,0 +1,60 @@
+#pragma once
+
+#include "cmd.hpp"
+#include "patch.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace fuzz
+{
+	// all terminal output during fuzzing goes through a single reporter
+	// thread so that the workers never block on printing and the
+	// output lines don't get mixed up with each other
+	class reporter
+	{
+	public:
+		// if print_usage is true, the resource usage is printed with the results
+		reporter(const bool print_usage = false);
+		~reporter();
+
+		reporter(const reporter&) = delete;
+		reporter& operator=(const reporter&) = delete;
+
+		// the note goes into its own column, for example how many times
+		// the result was reproduced
+		void report(const patch& p, const cmd_res res, const std::string& note = "");
+		void message(const std::string& msg);
+
+		// a spinner that hasn't been printed yet gets the new status instead
+		// of queueing another one, so the spinner can't fall behind
+		void print_spinner(const std::string& status = "");
+
+		// block until everything queued so far has been printed
+		void flush();
+
+	private:
+		void push(std::function<void()> printer);
+		void work();
+
+		std::deque<std::function<void()>> queue;
+		std::mutex mutex;
+		std::condition_variable queue_cv;
+		std::condition_variable empty_cv;
+		const bool print_usage;
+
+		// the latest status of the spinner and whether a spinner
+		// is waiting at the end of the queue to print it
+		std::string spinner_status;
+		bool spinner_queued{false};
+
+		bool printing{false};
+		bool stopping{false};
+
+		std::thread thread;
+	};
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "cmd.hpp"
+#include "sample_window.hpp"
+#include "types.hpp"
+
+namespace fuzz
+{
+	// the normal memory and cpu time usage of the command
+	//
+	// resource exhaustion is usually some kind of memory or cpu amplification,
+	// which the execution time catches late or not at all
+	class resource_model
+	{
+	public:
+		// started_from_fuzzer tells whether the commands are started
+		// straight from the fuzzer instead of a spawner or a forkserver
+		resource_model(const f32 usage_ratio, const bool started_from_fuzzer);
+
+		// add the usage of a run that didn't have anything abnormal about it
+		//
+		// this is safe to call from multiple workers at the same time
+		void add_sample(const cmd_res& res);
+		void add_sample(const u64 max_rss_kb, const u64 cpu_time_ns);
+
+		u64 median_max_rss_kb() const noexcept;
+		u64 median_cpu_time() const noexcept;
+
+		// the samples in the windows, used for checkpointing
+		std::vector<u64> max_rss_kb_snapshot() const;
+		std::vector<u64> cpu_time_snapshot() const;
+
+		// runs that use more cpu time than this are considered excessive
+		u64 cpu_time_threshold() const noexcept;
+
+		// the peak memory usage or the cpu time of the run is usage_ratio
+		// times higher than normal
+		bool is_excessive(const cmd_res& res) const noexcept;
+
+	private:
+		const f32 usage_ratio;
+		const bool started_from_fuzzer;
+		sample_window max_rss_kb;
+		sample_window cpu_time;
+	};
+}
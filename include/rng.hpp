@@ -0,0 +1,87 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <bit>
+#include <cstring>
+#include <limits>
+#include <span>
+
+namespace fuzz
+{
+	// xoshiro256** random number generator
+	//
+	// a lot faster than the mersenne twister, has a tiny state and
+	// can fill whole buffers with random bytes 8 bytes at a time
+	class rng
+	{
+	public:
+		using result_type = u64;
+
+		explicit rng(u64 seed) noexcept
+		{
+			// the state is expanded from the seed with splitmix64 so that
+			// similar seeds still end up with very different states
+			for (u64& s : state)
+			{
+				seed += 0x9e3779b97f4a7c15;
+				u64 z = seed;
+				z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+				z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+				s = z ^ (z >> 31);
+			}
+		}
+
+		static constexpr u64 min() noexcept { return 0; }
+		static constexpr u64 max() noexcept { return std::numeric_limits<u64>::max(); }
+
+		u64 operator()() noexcept
+		{
+			const u64 result = std::rotl(state[1] * 5, 7) * 9;
+			const u64 t = state[1] << 17;
+
+			state[2] ^= state[0];
+			state[3] ^= state[1];
+			state[1] ^= state[2];
+			state[0] ^= state[3];
+			state[2] ^= t;
+			state[3] = std::rotl(state[3], 45);
+
+			return result;
+		}
+
+		// random number in the range [0, n)
+		//
+		// the modulo bias is negligible with 64-bit numbers and
+		// the ranges used for fuzzing
+		u64 below(const u64 n) noexcept
+		{
+			return (*this)() % n;
+		}
+
+		// true with the probability of 1 / n
+		bool one_in(const u64 n) noexcept
+		{
+			return below(n) == 0;
+		}
+
+		void fill(const std::span<u8> bytes) noexcept
+		{
+			u64 i = 0;
+			for (; i + sizeof(u64) <= bytes.size(); i += sizeof(u64))
+			{
+				const u64 value = (*this)();
+				std::memcpy(bytes.data() + i, &value, sizeof(u64));
+			}
+
+			if (i < bytes.size())
+			{
+				const u64 value = (*this)();
+				std::memcpy(bytes.data() + i, &value, bytes.size() - i);
+			}
+		}
+
+	private:
+		u64 state[4];
+	};
+}
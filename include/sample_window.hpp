@@ -0,0 +1,47 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace fuzz
+{
+	// a window of the most recent samples of some measurement with
+	// robust statistics that can be read without locking anything
+	class sample_window
+	{
+	public:
+		sample_window();
+
+		// this is safe to call from multiple workers at the same time
+		void add(const u64 sample);
+
+		u64 median() const noexcept;
+		u64 p99() const noexcept;
+
+		// median absolute deviation from the median
+		u64 mad() const noexcept;
+
+		// copy of the samples in the window, in no particular order
+		std::vector<u64> snapshot() const;
+
+	private:
+		void update_stats();
+
+		mutable std::mutex mutex;
+
+		// ring buffer of the most recent samples so that the
+		// stats can follow changes in the load of the machine
+		std::vector<u64> samples;
+		u64 next_sample{0};
+		u64 samples_since_update{0};
+
+		// the stats get recalculated every now and then while
+		// the workers read them without locking anything
+		std::atomic<u64> median_value{0};
+		std::atomic<u64> p99_value{0};
+		std::atomic<u64> mad_value{0};
+	};
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "types.hpp"
+
+namespace fuzz
+{
+	// a range of the file that gets fuzzed
+	struct section
+	{
+		u64 address;
+		u64 size;
+
+		u64 end_address() const noexcept { return address + size; }
+	};
+}
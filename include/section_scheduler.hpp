@@ -0,0 +1,44 @@
+#pragma once
+
+#include "rng.hpp"
+#include "section.hpp"
+#include "types.hpp"
+
+#include <atomic>
+#include <vector>
+
+namespace fuzz
+{
+	// spreads the executions across the sections of the file
+	//
+	// every section starts with the same weight, after which the weights
+	// follow how many anomalies each section has produced per execution,
+	// so the sections that actually cause trouble get fuzzed more often
+	class section_scheduler
+	{
+	public:
+		explicit section_scheduler(const std::vector<section>& sections);
+
+		// pick the index of the section for the next execution
+		//
+		// this is safe to call from multiple workers at the same time
+		u64 pick(rng& r) const;
+
+		// record the outcome of an execution in the section
+		//
+		// this is safe to call from multiple workers at the same time
+		void record(const u64 index, const bool anomaly);
+
+		// continue from the counts of an earlier campaign
+		void restore(const u64 index, const u64 execution_count, const u64 anomaly_count);
+
+		const std::vector<section>& sections() const noexcept;
+		u64 execution_count(const u64 index) const noexcept;
+		u64 anomaly_count(const u64 index) const noexcept;
+
+	private:
+		const std::vector<section> section_list;
+		std::vector<std::atomic<u64>> executions;
+		std::vector<std::atomic<u64>> anomalies;
+	};
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "patch.hpp"
+#include "rng.hpp"
+#include "types.hpp"
+
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace fuzz
+{
+	// a patch and how much it costs to run the command with it
+	struct slow_patch
+	{
+		patch p;
+		u64 section_index;
+
+		// the execution time or the cpu time of the command in nanoseconds
+		u64 cost;
+	};
+
+	// the slowest patches found so far in the slowdown mode
+	//
+	// new patches are mostly made by mutating the patches in the population,
+	// so the search keeps going towards the inputs that get slower instead
+	// of spreading the executions evenly over random patches
+	class slowdown_population
+	{
+	public:
+		explicit slowdown_population(const u64 capacity);
+
+		// the cost that a patch needs to go over to get into the population,
+		// zero if there is still room for more patches
+		//
+		// this is safe to call from multiple workers at the same time
+		u64 admission_cost() const;
+
+		// add the patch to the population if it is slower than the fastest
+		// patch in it, returns true if the patch got in
+		//
+		// this is safe to call from multiple workers at the same time
+		bool offer(const slow_patch& s);
+
+		// pick a parent for the next patch, slower patches are picked more often
+		//
+		// this is safe to call from multiple workers at the same time
+		std::optional<slow_patch> pick(rng& r) const;
+
+		// the patches in the population from the slowest to the fastest
+		std::vector<slow_patch> snapshot() const;
+
+	private:
+		const u64 capacity;
+		mutable std::mutex mutex;
+
+		// sorted from the slowest to the fastest
+		std::vector<slow_patch> entries;
+	};
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "cmd.hpp"
+#include "types.hpp"
+
+#include <span>
+#include <string>
+#include <sys/types.h>
+
+namespace fuzz
+{
+	// a small helper process that starts the commands of a worker in the mem mode
+	//
+	// the peak memory usage that wait4 reports for a command is at least the
+	// peak of the address space that exec replaced, so a command started
+	// straight from the fuzzer would look as big as the fuzzer itself. the
+	// spawner is a fresh copy of the fuzzer that returns to fork commands
+	// before it has allocated anything, so the commands only carry its small
+	// footprint and their peak memory usage is comparable between runs
+	//
+	// the commands are forked by the spawner, so it can also set their
+	// resource limits before exec instead of after the command has started
+	class spawner
+	{
+	public:
+		// if coverage_fd isn't -1, the commands get it as the shared
+		// memory that the coverage runtime writes the hit counts into
+		explicit spawner(const command& cmd, const i32 coverage_fd = -1);
+		~spawner();
+
+		spawner(const spawner&) = delete;
+		spawner& operator=(const spawner&) = delete;
+
+		// if stdin_bytes isn't empty, they are written into a pipe that is
+		// used as the stdin of the command
+		cmd_res run(const exec_limits& limits, const std::span<const u8> stdin_bytes = {});
+
+	private:
+		void read_exact(void* buffer, const u64 size);
+
+		const std::string program;
+		pid_t pid;
+		i32 socket_fd;
+	};
+
+	// if this process was started as a spawner, serve the fuzzer that
+	// started it and exit once it goes away, otherwise return right away
+	//
+	// this needs to be called before main has allocated anything
+	void serve_as_spawner(char** argv);
+}
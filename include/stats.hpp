@@ -0,0 +1,124 @@
+#pragma once
+
+#include "cmd.hpp"
+#include "timer.hpp"
+#include "types.hpp"
+
+#include <array>
+#include <atomic>
+#include <string>
+
+namespace fuzz
+{
+	// histogram of durations in nanoseconds with logarithmic buckets
+	//
+	// every power of two is split into a few linear buckets, so the
+	// percentiles are accurate to within ~12% no matter how long or
+	// short the durations are, and recording is a single atomic add
+	class histogram
+	{
+	public:
+		// this is safe to call from multiple workers at the same time
+		void record(const u64 ns) noexcept;
+
+		u64 count() const noexcept;
+		u64 total() const noexcept;
+		u64 max() const noexcept;
+
+		// the lower bound of the bucket that the percentile falls in, p is [0, 1]
+		u64 percentile(const f64 p) const noexcept;
+
+	private:
+		static constexpr u64 sub_bucket_bits = 3;
+		static constexpr u64 sub_bucket_count = 1 << sub_bucket_bits;
+
+		// values below this get a bucket of their own
+		static constexpr u64 linear_limit = sub_bucket_count * 2;
+
+		static constexpr u64 bucket_count = linear_limit + (64 - sub_bucket_bits - 1) * sub_bucket_count;
+
+		static u64 bucket_index(const u64 ns) noexcept;
+		static u64 bucket_lower_bound(const u64 index) noexcept;
+
+		std::array<std::atomic<u64>, bucket_count> buckets{};
+		std::atomic<u64> count_value{0};
+		std::atomic<u64> total_value{0};
+		std::atomic<u64> max_value{0};
+	};
+
+	// the parts that the time of a single execution is spent in
+	enum phase
+	{
+		// coming up with a new patch and checking if it has been tried before
+		mutate,
+
+		// applying the patch to the file of the worker
+		patch_file,
+
+		// starting the command or asking the forkserver for a new child
+		spawn,
+
+		// the command running, from being started to being reaped
+		target,
+
+		// checking the results, updating the baselines and reporting
+		bookkeeping,
+
+		phase_count
+	};
+
+	constexpr std::array<const char*, phase_count> phase_names = {
+		"mutate", "patch", "spawn", "target", "bookkeeping"
+	};
+
+	// counters and latency histograms of the campaign, all of
+	// which can be updated without locking anything
+	class stats
+	{
+	public:
+		stats();
+
+		// record the phases of an execution that the command result has timings for
+		void record_execution(const cmd_res& res) noexcept;
+		void record_phase(const phase ph, const u64 ns) noexcept;
+		void record_anomalies(const bool crash, const bool hang, const bool resource_exhaustion) noexcept;
+		void record_minimization(const u64 execution_count) noexcept;
+
+		// executions that were done somewhere else, like by the workers of a coordinator
+		void record_executions(const u64 count) noexcept;
+
+		// remember when the first anomaly that the mode is looking for was found
+		void record_finding() noexcept;
+
+		// an anomaly that didn't reproduce when it was run again
+		void record_unconfirmed() noexcept;
+
+		// the edges reached so far and the amount of seeds that reached new ones
+		void record_coverage(const u64 edge_count, const u64 seed_count) noexcept;
+
+		u64 executions() const noexcept;
+		f64 execs_per_sec() const noexcept;
+
+		// a short summary of the execution speed and findings for the terminal
+		std::string status_line() const;
+
+		// everything in a json object, for the status file
+		std::string to_json() const;
+
+	private:
+		timer elapsed;
+		std::array<histogram, phase_count> phases;
+		std::atomic<u64> execution_count{0};
+		std::atomic<u64> crashes{0};
+		std::atomic<u64> hangs{0};
+		std::atomic<u64> resource_exhaustions{0};
+		std::atomic<u64> minimization_executions{0};
+		std::atomic<u64> unconfirmed_anomalies{0};
+		std::atomic<u64> edges{0};
+		std::atomic<u64> seeds{0};
+
+		// when the first finding was found, zero until then
+		std::atomic<u64> first_finding_ms{0};
+		std::atomic<u64> first_finding_execs{0};
+	};
+}
@@ -6,13 +6,16 @@
 
 namespace fuzz
 {
+	// measures elapsed time on the monotonic clock, so that changes
+	// to the system time don't show up as slow or fast executions
 	class timer
 	{
 	public:
 		void start();
 		u64 elapsed_millis() const;
+		u64 elapsed_nanos() const;
 
 	private:
-		std::chrono::time_point<std::chrono::high_resolution_clock> start_time;
+		std::chrono::time_point<std::chrono::steady_clock> start_time;
 	};
 }
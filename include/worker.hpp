@@ -0,0 +1,78 @@
+#pragma once
+
+#include "args.hpp"
+#include "cmd.hpp"
+#include "coverage.hpp"
+#include "forkserver.hpp"
+#include "patch.hpp"
+#include "patched_file.hpp"
+#include "perf_counters.hpp"
+#include "rng.hpp"
+#include "spawner.hpp"
+#include "types.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace fuzz
+{
+	// the mem mode compares the peak memory usage of the commands, which
+	// is only accurate if they aren't started straight from the fuzzer,
+	// so they are started from a spawner unless the forkserver is used
+	bool uses_spawner(const opts& o);
+
+	// a worker owns its own copy of the patched file and the command
+	// that uses it, so that multiple workers can run the command at
+	// the same time without overwriting each others files
+	class worker
+	{
+	public:
+		worker(const u64 id, const opts& o, const std::vector<u8>& orig_bytes, const u64 seed);
+
+		// apply the patch to the workers own copy of the
+		// original file and run the command with it
+		//
+		// the command gets killed if it takes longer than the time limit
+		cmd_res execute(const patch& p, const u64 execution_time_limit_ns);
+
+		// the hit counts of the edges of the last run, empty
+		// if the coverage isn't being collected
+		std::span<const u8> coverage_counters() const noexcept;
+
+		const u64 id;
+
+		// each worker has its own random number generator so that
+		// patches can be generated without locking anything
+		fuzz::rng rng;
+
+	private:
+		patched_file file;
+		const command command_with_patched_bin;
+		const u64 kill_grace_ms;
+		const u64 cpu_limit_s;
+		const u64 memory_limit_mb;
+		const bool use_stdin;
+		const std::string forkserver_shim_path;
+		const bool use_spawner;
+		const bool use_perf_counters;
+
+		// the checksum fields of the layout, fixed up after every patch
+		std::vector<field> checksums;
+
+		// the counters only follow the processes started by the thread that
+		// opened them, so they, the forkserver and the spawner are set up
+		// on the first run from the thread of the worker
+		std::unique_ptr<perf_counters> counters;
+
+		// only used if the forkserver mode is enabled
+		std::unique_ptr<forkserver> fserver;
+
+		// starts the commands in the mem mode if the forkserver mode isn't enabled,
+		// otherwise they are started straight from the fuzzer with run_cmd
+		std::unique_ptr<spawner> cmd_spawner;
+
+		// only used if the coverage is being collected
+		std::unique_ptr<coverage_map> coverage;
+	};
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "args.hpp"
+#include "types.hpp"
+#include "worker.hpp"
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace fuzz
+{
+	using job_fn = std::function<void(worker& w, const u64 index)>;
+
+	class worker_pool
+	{
+	public:
+		worker_pool(const opts& o, const std::vector<u8>& orig_bytes, const u64 seed);
+		~worker_pool();
+
+		worker_pool(const worker_pool&) = delete;
+		worker_pool& operator=(const worker_pool&) = delete;
+
+		u64 size() const noexcept;
+
+		// reseed the random number generators of the workers the same way
+		// as when the pool was created, this must not be called while a
+		// batch of jobs is running
+		void reseed(const u64 seed);
+
+		// run the job once for every index in [0, count) spread over
+		// all of the workers and block until every job has finished
+		void run(const u64 count, const job_fn& job);
+
+	private:
+		void work(worker& w);
+
+		std::vector<std::unique_ptr<worker>> workers;
+		std::vector<std::thread> threads;
+
+		std::mutex mutex;
+		std::condition_variable job_cv;
+		std::condition_variable done_cv;
+
+		const job_fn* current_job{nullptr};
+		u64 job_count{0};
+		u64 next_job{0};
+		u64 finished_jobs{0};
+		bool stopping{false};
+	};
+}
@@ -0,0 +1,89 @@
+// coverage runtime for targets that are built with -fsanitize-coverage=trace-pc-guard
+// (clang) or -fsanitize-coverage=trace-pc (gcc) and linked with this library
+//
+// the edges between the instrumented blocks are hashed into 8-bit hit counters
+// in shared memory, which the fuzzer clears before each run and reads after it
+
+#include "coverage_protocol.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <sys/mman.h>
+
+// start of the executable, set by the linker
+extern "C" char __executable_start;
+
+// the callbacks that the instrumentation calls
+extern "C"
+{
+	void __sanitizer_cov_trace_pc_guard_init(uint32_t* start, uint32_t* stop);
+	void __sanitizer_cov_trace_pc_guard(uint32_t* guard);
+	void __sanitizer_cov_trace_pc();
+}
+
+namespace
+{
+	using namespace fuzz::coverage_protocol;
+
+	// the counters go here until the shared memory has been mapped,
+	// and for good if the target isn't being run by the fuzzer
+	unsigned char fallback_map[map_size];
+	unsigned char* map = fallback_map;
+
+	// the same block reached from a different block is a different edge
+	thread_local uintptr_t prev_location;
+
+	uint32_t guard_count;
+
+	__attribute__((constructor))
+	void map_coverage()
+	{
+		if (!std::getenv(enable_env))
+			return;
+
+		void* shared = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, coverage_fd, 0);
+		if (shared != MAP_FAILED)
+			map = static_cast<unsigned char*>(shared);
+	}
+
+	// spread the locations over the whole map so that neighbouring
+	// blocks don't end up in neighbouring counters
+	inline uintptr_t scramble(uintptr_t location)
+	{
+		location ^= location >> 16;
+		location *= 0x7feb352d;
+		location ^= location >> 15;
+		return location;
+	}
+
+	inline void hit(const uintptr_t location)
+	{
+		const uintptr_t current = scramble(location) & (map_size - 1);
+		++map[current ^ prev_location];
+		prev_location = current >> 1;
+	}
+}
+
+extern "C" void __sanitizer_cov_trace_pc_guard_init(uint32_t* start, uint32_t* stop)
+{
+	// the guards of a module only need to be numbered once
+	if (start == stop || *start != 0)
+		return;
+
+	for (uint32_t* guard = start; guard < stop; ++guard)
+		*guard = ++guard_count;
+}
+
+extern "C" void __sanitizer_cov_trace_pc_guard(uint32_t* guard)
+{
+	if (*guard != 0)
+		hit(*guard);
+}
+
+// gcc only tells the return address, which is relative to the start of the
+// executable so that it stays the same when the executable gets loaded at
+// a different address
+extern "C" void __sanitizer_cov_trace_pc()
+{
+	hit(reinterpret_cast<uintptr_t>(__builtin_return_address(0)) - reinterpret_cast<uintptr_t>(&__executable_start));
+}
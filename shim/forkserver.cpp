@@ -0,0 +1,176 @@
+// a preloadable library that turns the target into a forkserver
+//
+// the target stops right before main and forks a new child for each run
+// request, so the dynamic linking and the static initialization of the
+// target are only paid once. the shim wraps __libc_start_main to get
+// there, since the constructors of the target would run after a
+// constructor of the shim. threads that the static initialization
+// started don't make it into the children
+
+#include "forkserver_protocol.hpp"
+
+#include <cerrno>
+#include <cstdlib>
+#include <dlfcn.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace
+{
+	using namespace fuzz::forkserver_protocol;
+
+	bool read_exact(void* buffer, const unsigned long size)
+	{
+		unsigned long bytes_read = 0;
+
+		while (bytes_read < size)
+		{
+			const ssize_t res = read(control_fd, static_cast<char*>(buffer) + bytes_read, size - bytes_read);
+			if (res > 0)
+			{
+				bytes_read += res;
+				continue;
+			}
+
+			if (res == -1 && errno == EINTR)
+				continue;
+
+			return false;
+		}
+
+		return true;
+	}
+
+	bool write_u32(const unsigned int value)
+	{
+		return write(status_fd, &value, sizeof(value)) == sizeof(value);
+	}
+
+	void apply_limits(const run_limits& limits)
+	{
+		if (limits.cpu_limit_s != 0)
+		{
+			// the hard limit is a second higher so that the process gets a SIGXCPU
+			// first and a SIGKILL only if it doesn't stop after that
+			const rlimit cpu_limit{ limits.cpu_limit_s, limits.cpu_limit_s + 1 };
+			setrlimit(RLIMIT_CPU, &cpu_limit);
+		}
+
+		if (limits.memory_limit_mb != 0)
+		{
+			const rlim_t memory_limit = limits.memory_limit_mb * 1024 * 1024;
+			const rlimit as_limit{ memory_limit, memory_limit };
+			setrlimit(RLIMIT_AS, &as_limit);
+		}
+	}
+
+	using main_fn = int (*)(int, char**, char**);
+	using libc_start_main_fn = int (*)(main_fn, int, char**, void (*)(), void (*)(), void (*)(), void*);
+
+	main_fn target_main = nullptr;
+
+	// returns in the children and only if there's no fuzzer to serve,
+	// the forkserver itself exits once the fuzzer goes away
+	void start_forkserver()
+	{
+		if (!std::getenv(enable_env))
+			return;
+
+		// programs started by the target shouldn't become forkservers too
+		unsetenv(enable_env);
+		unsetenv("LD_PRELOAD");
+
+		// if nobody is listening, run the target normally
+		if (!write_u32(hello))
+			return;
+
+		unsigned int request;
+		run_limits limits;
+		while (read_exact(&request, sizeof(request)) && read_exact(&limits, sizeof(limits)))
+		{
+			const pid_t pid = fork();
+			if (pid == -1)
+				_exit(1);
+
+			// the child continues to main in a process group of its own
+			// so that the fuzzer can kill it and everything it starts
+			if (pid == 0)
+			{
+				setpgid(0, 0);
+				apply_limits(limits);
+				close(control_fd);
+				close(status_fd);
+				return;
+			}
+
+			// the group is created from both sides so that it exists by the
+			// time the fuzzer gets the pid, no matter which one runs first
+			setpgid(pid, pid);
+
+			if (!write_u32(pid))
+				_exit(1);
+
+			// the child is left as a zombie until the fuzzer is done with it
+			siginfo_t info;
+			while (waitid(P_PID, pid, &info, WEXITED | WNOWAIT) == -1)
+			{
+				if (errno != EINTR)
+					_exit(1);
+			}
+
+			unsigned int reap;
+			if (!write_u32(child_exited) || !read_exact(&reap, sizeof(reap)) || reap != reap_request)
+				_exit(1);
+
+			int status;
+			rusage usage;
+			while (wait4(pid, &status, 0, &usage) == -1)
+			{
+				if (errno != EINTR)
+					_exit(1);
+			}
+
+			if (!write_u32(status))
+				_exit(1);
+
+			const child_usage child{
+				static_cast<unsigned long long>(usage.ru_maxrss),
+				static_cast<unsigned long long>(usage.ru_utime.tv_sec * 1'000'000 + usage.ru_utime.tv_usec),
+				static_cast<unsigned long long>(usage.ru_stime.tv_sec * 1'000'000 + usage.ru_stime.tv_usec),
+				static_cast<unsigned long long>(usage.ru_minflt),
+				static_cast<unsigned long long>(usage.ru_majflt),
+				static_cast<unsigned long long>(usage.ru_nvcsw),
+				static_cast<unsigned long long>(usage.ru_nivcsw)
+			};
+
+			if (write(status_fd, &child, sizeof(child)) != sizeof(child))
+				_exit(1);
+		}
+
+		// the fuzzer has closed the control pipe
+		_exit(0);
+	}
+
+	int forkserver_main(int argc, char** argv, char** envp)
+	{
+		start_forkserver();
+		return target_main(argc, argv, envp);
+	}
+}
+
+extern "C" int __libc_start_main(main_fn main, int argc, char** argv, void (*init)(), void (*fini)(), void (*rtld_fini)(), void* stack_end);
+
+// the target calls this from its entry point to run its static
+// initialization and then main, so swapping main for forkserver_main
+// puts the fork point after everything else
+extern "C" int __libc_start_main(main_fn main, int argc, char** argv, void (*init)(), void (*fini)(), void (*rtld_fini)(), void* stack_end)
+{
+	const libc_start_main_fn libc_start_main = reinterpret_cast<libc_start_main_fn>(dlsym(RTLD_NEXT, "__libc_start_main"));
+	if (!libc_start_main)
+		_exit(1);
+
+	target_main = main;
+	return libc_start_main(forkserver_main, argc, argv, init, fini, rtld_fini, stack_end);
+}
@@ -1,24 +1,140 @@
 #include "args.hpp"
+#include "cmd.hpp"
 #include "io.hpp"
+#include "perf_counters.hpp"
 
+#include <algorithm>
 #include <clipp.h>
 #include <filesystem>
+#include <fstream>
 #include <format>
 #include <iostream>
-#include <regex>
+#include <sstream>
+#include <unistd.h>
 
 namespace fuzz
 {
 	constexpr char patched_postfix[] = ".patched";
 
+	// the address space limit of the commands in the mem mode if --mem-limit
+	// isn't given, half of the physical memory of the machine split between the jobs
+	static u64 default_mem_mode_memory_limit_mb(const u64 jobs)
+	{
+		const u64 physical_memory_mb = static_cast<u64>(sysconf(_SC_PHYS_PAGES)) * sysconf(_SC_PAGESIZE) / (1024 * 1024);
+		return std::max<u64>(physical_memory_mb / 2 / jobs, 1);
+	}
+
+	// parse a comma separated list of mutation names with optional weights,
+	// for example "random:4,bitflip,interesting:2"
+	//
+	// mutations that are left out of the list don't get used at all
+	static mutation_weights parse_mutation_weights(const std::string& str)
+	{
+		mutation_weights weights{};
+
+		std::stringstream stream(str);
+		std::string item;
+		while (std::getline(stream, item, ','))
+		{
+			const size_t colon = item.find(':');
+			const std::string name = item.substr(0, colon);
+
+			const auto it = std::find_if(mutation_names.begin(), mutation_names.end(), [&name](const char* n) { return name == n; });
+			if (it == mutation_names.end())
+				fatal_error(std::format("unknown mutation '{}'", name));
+
+			u32 weight = 1;
+			if (colon != std::string::npos)
+			{
+				try
+				{
+					weight = std::stoul(item.substr(colon + 1));
+				}
+				catch (const std::exception& e)
+				{
+					fatal_error(std::format("the weight of the mutation '{}' is not a valid number", name));
+				}
+			}
+
+			weights[it - mutation_names.begin()] = weight;
+		}
+
+		if (std::all_of(weights.begin(), weights.end(), [](const u32 w) { return w == 0; }))
+			fatal_error("at least one mutation needs to have a non-zero weight");
+
+		return weights;
+	}
+
+	// the default weights in the same format that the command line option uses
+	static std::string mutation_weights_str(const mutation_weights& weights)
+	{
+		std::string str;
+
+		for (u64 i = 0; i < mutation_count; ++i)
+			str += std::format("{}{}:{}", i == 0 ? "" : ",", mutation_names[i], weights[i]);
+
+		return str;
+	}
+
+	// convert a hex string into a number, what tells what the number was supposed to be
+	static u64 parse_hex(const std::string& str, const std::string& what)
+	{
+		try
+		{
+			return std::stoul(str, 0, 16);
+		}
+		catch (const std::exception& e)
+		{
+			fatal_error(std::format("the given {} '{}' is not a valid hex string", what, str));
+		}
+	}
+
+	// read sections from a file that has the address and the size
+	// of a section on each line in hexadecimal format
+	//
+	// empty lines and lines starting with # are skipped
+	static std::vector<section> read_section_file(const std::string& path)
+	{
+		std::ifstream file(path);
+		if (!file.is_open())
+			fatal_error(std::format("could not open the section file '{}'", path));
+
+		std::vector<section> sections;
+
+		std::string line;
+		while (std::getline(file, line))
+		{
+			std::stringstream stream(line);
+			std::string address_str, size_str;
+			stream >> address_str >> size_str;
+
+			if (address_str.empty() || address_str.starts_with('#'))
+				continue;
+
+			if (size_str.empty())
+				fatal_error(std::format("the section '{}' in '{}' is missing a size", address_str, path));
+
+			sections.push_back({ parse_hex(address_str, "section address"), parse_hex(size_str, "section size") });
+		}
+
+		return sections;
+	}
+
 	opts parse_cli_args(const int argc, char** const argv)
 	{
-		std::string section_address_str;
-		std::string section_size_str;
+		std::vector<std::string> section_address_strs;
+		std::vector<std::string> section_size_strs;
+		std::string section_file_path;
 		std::string command;
+		std::string input_mode_str = "file";
+		std::string time_metric_str = "wall";
+		std::string value_order_str = "interesting";
+		std::string mutations_str;
+		std::string layout_path;
 		opts o;
 
 		bool print_help{false};
+		bool memory_limit_given{false};
 
 		auto cli = (
 			(clipp::option("-c", "--cmd").required(true) & clipp::value("command").set(command))
@@ -27,20 +143,44 @@ namespace fuzz
 			(clipp::option("-f", "--file").required(true) & clipp::value("file_path").set(o.original_bin_path))
 			% "path to the file that will be used for fuzzing",
 
-			(clipp::option("-a", "--addr").required(true) & clipp::value("section_address").set(section_address_str))
-			% "starting address of the section to fuzz in the binary in hexadecimal format",
+			(clipp::option("-a", "--addr") & clipp::values("section_address").set(section_address_strs))
+			% "starting addresses of the sections to fuzz in the binary in hexadecimal format; if no sections are given, the whole file gets fuzzed",
+
+			(clipp::option("-s", "--size") & clipp::values("section_size").set(section_size_strs))
+			% "the sizes of the binary sections to fuzz in hexadecimal format, one for each address",
 
-			(clipp::option("-s", "--size").required(true) & clipp::value("section_size").set(section_size_str))
-			% "the size of the binary section to fuzz in hexadecimal format",
+			(clipp::option("--sections") & clipp::value("file").set(section_file_path))
+			% "read more sections from a file with the address and the size of a section in hexadecimal format on each line",
 
 			clipp::one_of(
 				clipp::option("-r", "--ret").set(o.mode, mode::ret)
 				% "if a non-zero return value is encountered, try to find the minimal amount of changes needed to cause the crash",
 
 				clipp::option("-t", "--time").set(o.mode, mode::time)
-				% "if the command execution takes abnormally long, try to find the minimal amount of changes needed to cause the freezing"
+				% "if the command execution takes abnormally long, try to find the minimal amount of changes needed to cause the freezing",
+
+				clipp::option("-m", "--mem").set(o.mode, mode::mem)
+				% "if the command uses abnormally much memory or cpu time, try to find the minimal amount of changes needed to cause the resource exhaustion",
+
+				clipp::option("--slowdown").set(o.mode, mode::slowdown)
+				% "look for the patches that make the command as slow as possible by mutating the slowest patches found so far; runs until interrupted and reports every new slowest patch"
 			),
 
+			(clipp::option("--time-metric") & clipp::value("metric").set(time_metric_str))
+			% "what counts as the execution time; 'wall' is the time from starting the command to it exiting, 'cpu' is the cpu time the command used, which isn't affected by the load of the machine and can tell apart slowdowns that are less than a millisecond, and 'instructions' is the amount of instructions the command retired, which is almost deterministic but needs hardware performance counters; without them, cpu is used instead (default: wall)",
+
+			clipp::option("--perf-counters").set(o.perf_counters)
+			% "count the instructions, branches and page faults of the command with perf_event_open and store them in the findings; this is implied by --time-metric instructions",
+
+			(clipp::option("--enumerate") & clipp::number("width").set(o.enumeration_width))
+			% std::format("instead of random mutations, try every combination of values of a window of 1-{} bytes at every address of the sections and stop once all of them have been tried; a width of 1 sweeps every value of a single byte over the sections", fuzz::max_enumeration_width),
+
+			(clipp::option("--value-order") & clipp::value("order").set(value_order_str))
+			% "the order that --enumerate and the final 1 byte search try the values of a byte in; 'interesting' tries values like 0x00, 0xff and 0x7f first, 'sequential' goes from 0x00 to 0xff (default: interesting)",
+
+			clipp::option("--coverage").set(o.coverage)
+			% "the command has been built with -fsanitize-coverage=trace-pc-guard (clang) or -fsanitize-coverage=trace-pc (gcc) and linked with libdos-fuzzer-coverage.a; patches that reach new edges in the command are kept as seeds that new patches get built on",
+
 			(clipp::option("-i", "--ignore-ret") & clipp::numbers("return_value").set(o.ignored_return_values))
 			% "ignore any number of return values (exit codes) that are not considered as crashes or malfunction",
 
@@ -48,11 +188,62 @@ namespace fuzz
 			% std::format("how many times to run the command normally when deducing the regular execution time (default: {})", o.test_run_count),
 
 			(clipp::option("-v", "--exec-time-variation") & clipp::number("multiplier").set(o.execution_time_variation_multiplier))
-			% std::format("the highest normal execution time is multiplied with this value to avoid false positives in case the command just happens to take a bit longer to execute sometimes (default: {})", o.execution_time_variation_multiplier),
+			% std::format("how many standard deviations (estimated from the median absolute deviation) above the p99 of the normal execution times the execution time limit is, to avoid false positives in case the command just happens to take a bit longer to execute sometimes (default: {})", o.execution_time_variation_multiplier),
+
+			(clipp::option("-u", "--usage-ratio") & clipp::number("ratio").set(o.usage_ratio))
+			% std::format("runs where the peak memory usage or the cpu time is this many times higher than normal are considered resource exhaustion (default: {})", o.usage_ratio),
 
 			(clipp::option("-b", "--max-bytes-to-change") & clipp::number("count").set(o.max_bytes_to_change))
 			% std::format("the maximum about of bytes to change when patching the binary; this value will be truncated to the section size if needed (default: {})", o.max_bytes_to_change),
 
+			clipp::option("--uniform-offsets").set(o.uniform_offsets)
+			% "spread the patches evenly over the sections instead of favouring the offsets and patch lengths that have caused anomalies, reached new coverage or slowed the command down",
+
+			(clipp::option("--mutations") & clipp::value("mutations").set(mutations_str))
+			% std::format("comma separated list of the mutations to use with optional weights for how often they get picked, mutations that are left out don't get used; available mutations are random, bitflip, arith, interesting, copy, shift, splice and field, which is only used with --layout (default: {})", mutation_weights_str(o.mutation_weights)),
+
+			(clipp::option("--layout") & clipp::value("file").set(layout_path))
+			% "file that describes the fields of the file format with a field on each line: the address in hex, the width in bytes, le or be and the type, which is length, count, offset, integer, crc32 or adler32; checksums are followed by the address and the size of the range they cover in hex. the fields get mutated with boundary values and the checksums get recalculated after patching",
+
+			(clipp::option("-j", "--jobs") & clipp::number("count").set(o.jobs))
+			% std::format("how many commands to run at the same time; each job gets its own copy of the patched file (default: {})", o.jobs),
+
+			(clipp::option("--mem-limit").set(memory_limit_given) & clipp::number("megabytes").set(o.memory_limit_mb))
+			% "limit the address space of the command with RLIMIT_AS so that a bad input can't take down the whole machine; zero means no limit (default: half of the physical memory split between the jobs with --mem, 0 otherwise)",
+
+			(clipp::option("--dedup-memory") & clipp::number("megabytes").set(o.dedup_memory_mb))
+			% std::format("how much memory to use for remembering which patches have already been tried; once it runs out, patches may get tried more than once (default: {})", o.dedup_memory_mb),
+
+			(clipp::option("--input-mode") & clipp::value("mode").set(input_mode_str))
+			% "how the patched file is given to the command; 'file' keeps a file next to the original file mapped into memory and 'memfd' keeps the file only in memory and substitutes %c with a /proc path to it, 'stdin' writes the file into the stdin of the command (default: file)",
+
+			(clipp::option("--kill-grace") & clipp::number("milliseconds").set(o.kill_grace_ms))
+			% std::format("commands that go over the execution time limit get a SIGTERM, after this long they get a SIGKILL (default: {})", o.kill_grace_ms),
+
+			(clipp::option("--cpu-limit") & clipp::number("seconds").set(o.cpu_limit_s))
+			% "RLIMIT_CPU for the command as a backstop for the execution time limit; if zero, it'll get set a bit higher than the execution time limit (default: 0)",
+
+			(clipp::option("--forkserver") & clipp::value("shim_path").set(o.forkserver_shim_path))
+			% "run the command as a forkserver by preloading the given shim library (libdos-fuzzer-forkserver.so); the target is started only once and forked right before main for each run",
+
+			(clipp::option("--verify-runs") & clipp::number("count").set(o.verify_runs))
+			% std::format("how many times to run each anomaly again before it counts as a finding; more than half of the runs need to run into the same kind of an anomaly, otherwise it gets dropped as noise. zero takes every anomaly as it is (default: {})", o.verify_runs),
+
+			(clipp::option("--max-execs") & clipp::number("count").set(o.max_execs))
+			% "stop the fuzzing after this many executions as if it had been interrupted; zero means no limit (default: 0)",
+
+			(clipp::option("-o", "--output") & clipp::value("dir").set(o.output_dir_path))
+			% "directory for storing every finding as a patch record and a checkpoint of the campaign; in the continuous mode, the fuzzing can be stopped with ctrl-c and the checkpoint gets saved",
+
+			clipp::option("--resume").set(o.resume)
+			% "continue the campaign from the checkpoint in the output directory without repeating the dry runs or the patches that have already been tried",
+
+			(clipp::option("--listen") & clipp::value("address").set(o.listen_address))
+			% "coordinate a distributed campaign: do the dry runs, hand out ranges of work to the workers that connect to the address and collect their findings and address statistics; the address is either <host>:<port> or a path to a unix socket",
+
+			(clipp::option("--connect") & clipp::value("address").set(o.connect_address))
+			% "fuzz as a worker of the coordinator at the address, using its seed and baselines; the file, the sections and the mode need to be the same as on the coordinator",
+
 			(clipp::option("--seed") & clipp::number("seed").set(o.seed))
 			% std::format("value used for seeding the random number generator; if zero, it'll get set to the current time (default: {})", o.seed),
 
@@ -70,32 +261,126 @@ namespace fuzz
 			fatal_error(std::format("the file '{}' does not exist", o.original_bin_path));
 
 		// convert the hex strings into numbers
-		try
-		{
-			o.section_address = std::stoul(section_address_str, 0, 16);
-		}
-		catch (const std::exception& e)
+		if (section_address_strs.size() != section_size_strs.size())
+			fatal_error("each section address needs a size and vice versa");
+
+		for (u64 i = 0; i < section_address_strs.size(); ++i)
+			o.sections.push_back({ parse_hex(section_address_strs[i], "section address"), parse_hex(section_size_strs[i], "section size") });
+
+		if (!section_file_path.empty())
 		{
-			fatal_error(std::format("the given section address '{}' is not a valid hex string", section_address_str));
+			const std::vector<section> file_sections = read_section_file(section_file_path);
+			o.sections.insert(o.sections.end(), file_sections.begin(), file_sections.end());
 		}
 
-		try
+		// without any sections, the whole file is a single section
+		if (o.sections.empty())
+			o.sections.push_back({ 0, std::filesystem::file_size(o.original_bin_path) });
+
+		if (input_mode_str == "file")
+			o.input_mode = input_mode::file;
+		else if (input_mode_str == "memfd")
+			o.input_mode = input_mode::memfd;
+		else if (input_mode_str == "stdin")
+			o.input_mode = input_mode::stdin;
+		else
+			fatal_error(std::format("unknown input mode '{}'", input_mode_str));
+
+		if (time_metric_str == "wall")
+			o.time_metric = time_metric::wall;
+		else if (time_metric_str == "cpu")
+			o.time_metric = time_metric::cpu;
+		else if (time_metric_str == "instructions")
+			o.time_metric = time_metric::instructions;
+		else
+			fatal_error(std::format("unknown time metric '{}'", time_metric_str));
+
+		if (value_order_str == "interesting")
+			o.value_order = value_order::interesting_first;
+		else if (value_order_str == "sequential")
+			o.value_order = value_order::sequential;
+		else
+			fatal_error(std::format("unknown value order '{}'", value_order_str));
+
+		if (o.time_metric == time_metric::instructions)
 		{
-			o.section_size = std::stoul(section_size_str, 0, 16);
+			const std::string reason = perf_counters::instructions_unavailable_reason();
+			if (reason.empty())
+			{
+				o.perf_counters = true;
+			}
+			else
+			{
+				std::cout << std::format("warning: retired instructions can't be counted ({}), using the cpu time metric instead\n", reason);
+				o.time_metric = time_metric::cpu;
+			}
 		}
-		catch (const std::exception& e)
+
+		// the shim path ends up in LD_PRELOAD, so it needs to be absolute
+		// for the dynamic linker to find it
+		if (!o.forkserver_shim_path.empty())
 		{
-			fatal_error(std::format("the given section size '{}' is not a valid hex string", section_size_str));
+			if (!std::filesystem::exists(o.forkserver_shim_path))
+				fatal_error(std::format("the forkserver shim '{}' does not exist", o.forkserver_shim_path));
+
+			o.forkserver_shim_path = std::filesystem::absolute(o.forkserver_shim_path).string();
 		}
 
-		// create the different commands
-		const std::regex cmd_regex("%c");
-		o.command_with_orig_bin = std::regex_replace(command, cmd_regex, o.original_bin_path);
-		o.command_with_patched_bin = std::regex_replace(command, cmd_regex, o.original_bin_path + patched_postfix);
+		if (o.resume && o.output_dir_path.empty())
+			fatal_error("--resume needs an output directory to resume from");
+
+		if (!o.listen_address.empty() && !o.connect_address.empty())
+			fatal_error("the fuzzer can't be both a coordinator and a worker");
+
+		// the seed and the baselines of a worker come from the coordinator
+		if (o.resume && !o.connect_address.empty())
+			fatal_error("--resume can't be used with --connect, resume the coordinator instead");
+
+		if (o.jobs == 0)
+			fatal_error("the job count needs to be at least 1");
+
+		// the mem mode goes looking for runaway allocations, so they get capped
+		// unless --mem-limit was given, and --mem-limit 0 removes the cap
+		if (o.mode == mode::mem && !memory_limit_given)
+			o.memory_limit_mb = default_mem_mode_memory_limit_mb(o.jobs);
+
+		for (const section& s : o.sections)
+			if (s.size == 0)
+				fatal_error(std::format("the size of the section at 0x{:x} needs to be at least 1", s.address));
+
+		if (o.max_bytes_to_change == 0)
+			fatal_error("the maximum amount of bytes to change needs to be at least 1");
+
+		if (!mutations_str.empty())
+			o.mutation_weights = parse_mutation_weights(mutations_str);
+
+		if (!layout_path.empty())
+			o.layout = read_layout_file(layout_path, std::filesystem::file_size(o.original_bin_path));
+
+		// the field mutation doesn't do anything without the fields, and the
+		// mutator skips the fields that are wider than -b allows
+		const auto usable_field = [&o](const field& f) { return !f.is_checksum() && f.width <= o.max_bytes_to_change; };
+		const bool has_fields = std::any_of(o.layout.begin(), o.layout.end(), usable_field);
+		u64 other_weights{0};
+		for (u64 i = 0; i < mutation_count; ++i)
+			if (i != mutation::layout_field)
+				other_weights += o.mutation_weights[i];
+
+		if (!has_fields && other_weights == 0)
+			fatal_error("the field mutation needs a layout with at least one field that isn't a checksum");
+
+		// split the command into arguments only once, the workers substitute
+		// their own file paths since each of them has a different patched file
+		o.command_args = split_command(command);
 
 		// create the patched bin path with a postfix
 		o.patched_bin_path = o.original_bin_path + patched_postfix;
 
+		// several workers of a distributed campaign can run on the same
+		// machine, so they need patched files of their own
+		if (!o.connect_address.empty())
+			o.patched_bin_path += std::format(".{}", getpid());
+
 		return o;
 	}
 }
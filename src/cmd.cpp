@@ -1,35 +1,429 @@
 #include "cmd.hpp"
+#include "coverage_protocol.hpp"
+#include "io.hpp"
 #include "timer.hpp"
 
-#include <cstdlib>
-#include <future>
-#include <iostream>
+#include <cassert>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <format>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 namespace fuzz
 {
-	using namespace std::chrono_literals;
+	// characters that need an actual shell to be interpreted correctly
+	constexpr char shell_metachars[] = "|&;<>()$`*?~\n";
 
-	constexpr std::chrono::milliseconds hanging_command_poll_time = 250ms;
+	// how often a process gets checked on if there's no pidfd to wait on
+	constexpr u64 exit_poll_interval_ns = 1'000'000;
 
-	cmd_res run_cmd(const std::string_view cmd, const u64 execution_time_limit_ms)
+	command::command(const std::vector<std::string>& args)
+	:args(args)
+	{
+		assert(!args.empty());
+
+		for (std::string& arg : this->args)
+			arg_ptrs.push_back(arg.data());
+
+		arg_ptrs.push_back(nullptr);
+	}
+
+	command::command(const command& other)
+	:command(other.args)
+	{}
+
+	char* const* command::argv() const noexcept
+	{
+		return arg_ptrs.data();
+	}
+
+	std::vector<std::string> split_command(const std::string& cmd)
+	{
+		std::vector<std::string> args;
+		std::string arg;
+		bool in_arg{false};
+		char quote{0};
+
+		for (u64 i = 0; i < cmd.size(); ++i)
+		{
+			const char c = cmd[i];
+
+			if (quote)
+			{
+				if (c == quote)
+					quote = 0;
+				else if (c == '\\' && quote == '"' && i + 1 < cmd.size())
+					arg.push_back(cmd[++i]);
+				else
+					arg.push_back(c);
+
+				continue;
+			}
+
+			if (std::strchr(shell_metachars, c))
+				return { "/bin/sh", "-c", cmd };
+
+			if (c == ' ' || c == '\t')
+			{
+				if (in_arg)
+					args.push_back(std::move(arg));
+
+				arg.clear();
+				in_arg = false;
+				continue;
+			}
+
+			in_arg = true;
+
+			if (c == '"' || c == '\'')
+				quote = c;
+			else if (c == '\\' && i + 1 < cmd.size())
+				arg.push_back(cmd[++i]);
+			else
+				arg.push_back(c);
+		}
+
+		if (quote)
+			fatal_error(std::format("the command '{}' has an unterminated quote", cmd));
+
+		if (in_arg)
+			args.push_back(std::move(arg));
+
+		if (args.empty())
+			fatal_error("the command is empty");
+
+		return args;
+	}
+
+	command substitute_file_path(const std::vector<std::string>& args, const std::string& path)
+	{
+		std::vector<std::string> substituted_args = args;
+
+		for (std::string& arg : substituted_args)
+		{
+			for (u64 pos = arg.find("%c"); pos != std::string::npos; pos = arg.find("%c", pos + path.size()))
+				arg.replace(pos, 2, path);
+		}
+
+		return command(substituted_args);
+	}
+
+	timespec deadline_after(const u64 ns)
+	{
+		timespec deadline;
+		clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+		deadline.tv_sec += ns / 1'000'000'000;
+		deadline.tv_nsec += ns % 1'000'000'000;
+		if (deadline.tv_nsec >= 1'000'000'000)
+		{
+			deadline.tv_nsec -= 1'000'000'000;
+			++deadline.tv_sec;
+		}
+
+		return deadline;
+	}
+
+	// calculate how long there is left until the deadline
+	// returns false if the deadline has passed already
+	static bool time_until(const timespec& deadline, timespec& timeout)
+	{
+		timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+
+		timeout = { deadline.tv_sec - now.tv_sec, deadline.tv_nsec - now.tv_nsec };
+		if (timeout.tv_nsec < 0)
+		{
+			timeout.tv_nsec += 1'000'000'000;
+			--timeout.tv_sec;
+		}
+
+		return timeout.tv_sec >= 0;
+	}
+
+	bool wait_for_fd(const i32 fd, const timespec& deadline)
+	{
+		pollfd pfd{ fd, POLLIN, 0 };
+
+		while (true)
+		{
+			timespec timeout;
+			if (!time_until(deadline, timeout))
+				return false;
+
+			const i32 ready = ppoll(&pfd, 1, &timeout, nullptr);
+
+			if (ready > 0)
+				return true;
+
+			if (ready == 0)
+				return false;
+
+			if (errno != EINTR)
+				fatal_error(std::format("waiting for the command failed: {}", std::strerror(errno)));
+		}
+	}
+
+	// wait until the process exits or the deadline passes by checking on it
+	// every now and then, for when a pidfd couldn't be opened for it
+	//
+	// the process is left as a zombie so that wait4 can still get its usage
+	// returns false if the deadline passed first
+	static bool wait_for_exit(const pid_t pid, const timespec& deadline)
+	{
+		while (true)
+		{
+			siginfo_t info{};
+			if (waitid(P_PID, pid, &info, WEXITED | WNOHANG | WNOWAIT) == -1 && errno != EINTR)
+				fatal_error(std::format("waiting for the command failed: {}", std::strerror(errno)));
+
+			if (info.si_pid == pid)
+				return true;
+
+			timespec timeout;
+			if (!time_until(deadline, timeout))
+				return false;
+
+			if (timeout.tv_sec > 0 || static_cast<u64>(timeout.tv_nsec) > exit_poll_interval_ns)
+				timeout = { 0, exit_poll_interval_ns };
+
+			nanosleep(&timeout, nullptr);
+		}
+	}
+
+	// vmsplice hands the pages of the buffer over to the pipe without copying them,
+	// which is fine since the buffer isn't modified while the command is running
+	void feed_stdin(const i32 pipe_fd, const i32 exit_fd, std::span<const u8> bytes, const timespec& deadline, const exec_limits& limits)
+	{
+		while (!bytes.empty())
+		{
+			// if there's no exit_fd, ppoll ignores the negative fd
+			pollfd pfds[2] = { { pipe_fd, POLLOUT, 0 }, { exit_fd, POLLIN, 0 } };
+
+			timespec timeout;
+			if (limits.time_limit_ns != no_time_limit && !time_until(deadline, timeout))
+				return;
+
+			const i32 ready = ppoll(pfds, 2, limits.time_limit_ns != no_time_limit ? &timeout : nullptr, nullptr);
+
+			if (ready == -1 && errno == EINTR)
+				continue;
+
+			if (ready <= 0 || pfds[1].revents || (pfds[0].revents & (POLLERR | POLLHUP)))
+				return;
+
+			iovec iov{ const_cast<u8*>(bytes.data()), bytes.size() };
+			const ssize_t written = vmsplice(pipe_fd, &iov, 1, SPLICE_F_NONBLOCK);
+
+			if (written == -1)
+			{
+				if (errno == EAGAIN || errno == EINTR)
+					continue;
+
+				// the command closed its stdin
+				return;
+			}
+
+			bytes = bytes.subspan(written);
+		}
+	}
+
+	void set_exit_status(cmd_res& res, const i32 status)
+	{
+		if (WIFEXITED(status))
+			res.return_value = WEXITSTATUS(status);
+		else if (WIFSIGNALED(status))
+			res.signal = WTERMSIG(status);
+	}
+
+	bool wait_or_kill(const pid_t pid, const i32 fd, const timespec& deadline, const exec_limits& limits)
+	{
+		const auto wait = [pid, fd](const timespec& until)
+		{
+			return fd != -1 ? wait_for_fd(fd, until) : wait_for_exit(pid, until);
+		};
+
+		if (limits.time_limit_ns == no_time_limit || wait(deadline))
+			return false;
+
+		// ask nicely first and give the process a chance to clean up
+		kill(-pid, SIGTERM);
+		wait(deadline_after(limits.kill_grace_ms * 1'000'000));
+
+		// the process group is killed even if the process exited already
+		// to get rid of any children it might have left behind, the process
+		// hasn't been reaped yet so its pid can't belong to anything else
+		kill(-pid, SIGKILL);
+
+		return true;
+	}
+
+	i32 dup_above_fixed_fds(const i32 fd)
+	{
+		if (fd == -1)
+			return -1;
+
+		const i32 copy = fcntl(fd, F_DUPFD_CLOEXEC, first_unreserved_fd);
+		if (copy == -1)
+			fatal_error(std::format("could not duplicate a file descriptor: {}", std::strerror(errno)));
+
+		return copy;
+	}
+
+	void apply_resource_limits(const exec_limits& limits)
+	{
+		if (limits.cpu_limit_s != 0)
+		{
+			// the hard limit is a second higher so that the process gets a SIGXCPU
+			// first and a SIGKILL only if it doesn't stop after that
+			const rlimit cpu_limit{ limits.cpu_limit_s, limits.cpu_limit_s + 1 };
+			setrlimit(RLIMIT_CPU, &cpu_limit);
+		}
+
+		if (limits.memory_limit_mb != 0)
+		{
+			const rlim_t memory_limit = limits.memory_limit_mb * 1024 * 1024;
+			const rlimit as_limit{ memory_limit, memory_limit };
+			setrlimit(RLIMIT_AS, &as_limit);
+		}
+	}
+
+	// runs in the child of vfork, which borrows the memory and the stack of
+	// the fuzzer until it execs, so this only sets up the process and never returns
+	//
+	// a failed exec is reported through exec_error, which the fuzzer sees
+	// once it continues after the child has exited
+	[[noreturn]] static void exec_command(const command& cmd, const exec_limits& limits, const i32 stdin_fd, const i32 coverage_fd,
+		const sigset_t& signal_mask, volatile i32& exec_error)
+	{
+		// the command is put into its own process group so that anything
+		// it starts can be killed together with it
+		setpgid(0, 0);
+
+		// SIGPIPE is ignored by the fuzzer because of the stdin pipes,
+		// but the command should get the default behaviour
+		struct sigaction default_action{};
+		default_action.sa_handler = SIG_DFL;
+		sigaction(SIGPIPE, &default_action, nullptr);
+
+		// the limits are in place before the command gets to run at all
+		apply_resource_limits(limits);
+
+		if (stdin_fd != -1)
+			dup2(stdin_fd, STDIN_FILENO);
+
+		if (coverage_fd != -1)
+			dup2(coverage_fd, coverage_protocol::coverage_fd);
+
+		sigprocmask(SIG_SETMASK, &signal_mask, nullptr);
+		execvp(cmd.argv()[0], cmd.argv());
+
+		exec_error = errno;
+		_exit(127);
+	}
+
+	cmd_res run_cmd(const command& cmd, const exec_limits& limits, const std::span<const u8> stdin_bytes, const i32 coverage_fd)
 	{
 		timer t;
 		cmd_res res;
 
+		const timespec deadline = deadline_after(limits.time_limit_ns == no_time_limit ? 0 : limits.time_limit_ns);
+
+		i32 stdin_pipe[2] = { -1, -1 };
+		if (!stdin_bytes.empty())
+		{
+			if (pipe2(stdin_pipe, O_CLOEXEC) == -1)
+				fatal_error(std::format("could not create a stdin pipe: {}", std::strerror(errno)));
+
+			// try to fit the whole input into the pipe at once, this fails
+			// silently if the input is larger than the maximum pipe size
+			fcntl(stdin_pipe[1], F_SETPIPE_SZ, stdin_bytes.size());
+			fcntl(stdin_pipe[1], F_SETFL, O_NONBLOCK);
+		}
+
+		// the fds that the child moves to stdin and to the fd of the coverage
+		// runtime can't be either of those fds themselves
+		const i32 child_stdin_fd = dup_above_fixed_fds(stdin_pipe[0]);
+		const i32 child_coverage_fd = dup_above_fixed_fds(coverage_fd);
+
+		// the signal handlers of the fuzzer shouldn't run in the child
+		// while it shares the memory of the fuzzer
+		sigset_t all_signals;
+		sigset_t signal_mask;
+		sigfillset(&all_signals);
+		pthread_sigmask(SIG_SETMASK, &all_signals, &signal_mask);
+
 		t.start();
 
-		std::future<i32> cmd_future = std::async(std::launch::async, std::system, cmd.data());
+		// vfork doesn't copy the page tables of the fuzzer, so starting
+		// the command costs the same no matter how big the fuzzer is
+		volatile i32 exec_error{0};
+		const pid_t pid = vfork();
+		if (pid == 0)
+			exec_command(cmd, limits, child_stdin_fd, child_coverage_fd, signal_mask, exec_error);
+
+		res.spawn_time = t.elapsed_nanos();
+		pthread_sigmask(SIG_SETMASK, &signal_mask, nullptr);
+
+		if (child_stdin_fd != -1)
+			close(child_stdin_fd);
+
+		if (child_coverage_fd != -1)
+			close(child_coverage_fd);
 
-		if (cmd_future.wait_for(std::chrono::milliseconds(execution_time_limit_ms)) != std::future_status::ready)
+		if (pid == -1)
+			fatal_error(std::format("could not start '{}': {}", cmd.argv()[0], std::strerror(errno)));
+
+		if (exec_error != 0)
+			fatal_error(std::format("could not start '{}': {}", cmd.argv()[0], std::strerror(exec_error)));
+
+		// a pidfd lets us wait for the process with a timeout without polling,
+		// if the kernel is too old for them, the process gets polled for instead
+		//
+		// the syscall is used directly since not all libc versions have a wrapper for it
+		const i32 pidfd = syscall(SYS_pidfd_open, pid, 0);
+
+		if (!stdin_bytes.empty())
 		{
-			while (cmd_future.wait_for(hanging_command_poll_time) != std::future_status::ready)
-			{
-				std::cout << "\033[2K\rcommand has been hanging for " << std::dec << t.elapsed_millis() / 1000.0f << "s" << std::flush;
-			}
+			close(stdin_pipe[0]);
+			feed_stdin(stdin_pipe[1], pidfd, stdin_bytes, deadline, limits);
+
+			// closing the pipe lets the command know that there's nothing more to read
+			close(stdin_pipe[1]);
+		}
+
+		res.timed_out = wait_or_kill(pid, pidfd, deadline, limits);
+
+		if (pidfd != -1)
+			close(pidfd);
+
+		i32 status;
+		rusage usage;
+		while (wait4(pid, &status, 0, &usage) == -1)
+		{
+			if (errno != EINTR)
+				fatal_error(std::format("wait4 failed: {}", std::strerror(errno)));
 		}
 
-		res.return_value = cmd_future.get();
-		res.exec_time = t.elapsed_millis();
+		res.exec_time = t.elapsed_nanos();
+		set_exit_status(res, status);
+
+		res.max_rss_kb = usage.ru_maxrss;
+		res.user_time = usage.ru_utime.tv_sec * 1'000'000'000ul + usage.ru_utime.tv_usec * 1'000ul;
+		res.system_time = usage.ru_stime.tv_sec * 1'000'000'000ul + usage.ru_stime.tv_usec * 1'000ul;
+		res.minor_faults = usage.ru_minflt;
+		res.major_faults = usage.ru_majflt;
+		res.voluntary_switches = usage.ru_nvcsw;
+		res.involuntary_switches = usage.ru_nivcsw;
 
 		return res;
 	}
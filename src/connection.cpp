@@ -0,0 +1,346 @@
+#include "connection.hpp"
+#include "io.hpp"
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace fuzz
+{
+	// the largest payload that is accepted, anything bigger is garbage
+	constexpr u64 max_payload_size = 64 * 1024 * 1024;
+
+	struct socket_address
+	{
+		bool is_unix;
+		std::string path;
+		std::string host;
+		std::string port;
+	};
+
+	static socket_address parse_address(const std::string& address)
+	{
+		constexpr char unix_prefix[] = "unix:";
+		if (address.starts_with(unix_prefix))
+			return { true, address.substr(std::strlen(unix_prefix)), "", "" };
+
+		if (address.find('/') != std::string::npos)
+			return { true, address, "", "" };
+
+		const u64 colon = address.rfind(':');
+		if (colon == std::string::npos || colon + 1 == address.size())
+			fatal_error(std::format("the address '{}' needs to be either <host>:<port> or a path to a unix socket", address));
+
+		// ipv6 addresses are written in brackets so that the port can be told apart
+		std::string host = address.substr(0, colon);
+		if (host.size() >= 2 && host.front() == '[' && host.back() == ']')
+			host = host.substr(1, host.size() - 2);
+
+		return { false, "", host, address.substr(colon + 1) };
+	}
+
+	static sockaddr_un unix_socket_address(const std::string& path)
+	{
+		sockaddr_un addr{};
+		addr.sun_family = AF_UNIX;
+
+		if (path.empty() || path.size() >= sizeof(addr.sun_path))
+			fatal_error(std::format("the unix socket path '{}' is either empty or too long", path));
+
+		std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+		return addr;
+	}
+
+	static addrinfo* resolve(const socket_address& addr, const bool passive)
+	{
+		addrinfo hints{};
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+		hints.ai_flags = passive ? AI_PASSIVE : 0;
+
+		addrinfo* result{nullptr};
+		const i32 err = getaddrinfo(addr.host.empty() ? nullptr : addr.host.c_str(), addr.port.c_str(), &hints, &result);
+		if (err != 0)
+			fatal_error(std::format("could not resolve '{}:{}': {}", addr.host, addr.port, gai_strerror(err)));
+
+		return result;
+	}
+
+	// the messages are small and every request waits for its reply,
+	// so they shouldn't sit in the send buffer waiting for more data
+	static void disable_nagle(const i32 fd)
+	{
+		const i32 enabled{1};
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enabled, sizeof(enabled));
+	}
+
+	// the sockets are close-on-exec so that the commands
+	// that the workers run don't keep them open
+	static i32 connect_to(const std::string& address)
+	{
+		const socket_address addr = parse_address(address);
+
+		if (addr.is_unix)
+		{
+			const sockaddr_un un = unix_socket_address(addr.path);
+			const i32 fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+			if (fd == -1 || connect(fd, reinterpret_cast<const sockaddr*>(&un), sizeof(un)) == -1)
+				fatal_error(std::format("could not connect to the coordinator at '{}': {}", address, std::strerror(errno)));
+
+			return fd;
+		}
+
+		addrinfo* const candidates = resolve(addr, false);
+		i32 fd{-1};
+		i32 err{0};
+		for (addrinfo* ai = candidates; ai && fd == -1; ai = ai->ai_next)
+		{
+			fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+			if (fd != -1 && connect(fd, ai->ai_addr, ai->ai_addrlen) == -1)
+			{
+				err = errno;
+				close(fd);
+				fd = -1;
+			}
+		}
+		freeaddrinfo(candidates);
+
+		if (fd == -1)
+			fatal_error(std::format("could not connect to the coordinator at '{}': {}", address, std::strerror(err)));
+
+		disable_nagle(fd);
+		return fd;
+	}
+
+	connection::connection(const std::string& address)
+	:fd(connect_to(address))
+	{}
+
+	connection::connection(const i32 fd)
+	:fd(fd)
+	{}
+
+	connection::~connection()
+	{
+		close(fd);
+	}
+
+	bool connection::send(const u32 type, const std::span<const u8> payload)
+	{
+		if (payload.size() > max_payload_size)
+			return false;
+
+		const std::array<u32, 2> header = { type, static_cast<u32>(payload.size()) };
+		return write_all(header.data(), sizeof(header)) && write_all(payload.data(), payload.size());
+	}
+
+	std::optional<message> connection::receive()
+	{
+		std::array<u32, 2> header;
+		if (!read_all(header.data(), sizeof(header)) || header[1] > max_payload_size)
+			return std::nullopt;
+
+		message msg{ header[0], std::vector<u8>(header[1]) };
+		if (!read_all(msg.payload.data(), msg.payload.size()))
+			return std::nullopt;
+
+		return msg;
+	}
+
+	void connection::shut_down()
+	{
+		shutdown(fd, SHUT_RDWR);
+	}
+
+	bool connection::write_all(const void* buffer, const u64 size)
+	{
+		const u8* bytes = static_cast<const u8*>(buffer);
+		u64 written{0};
+		while (written < size)
+		{
+			// SIGPIPE is ignored by the fuzzer, but a worker might not have set that up yet
+			const ssize_t count = ::send(fd, bytes + written, size - written, MSG_NOSIGNAL);
+			if (count == -1 && errno == EINTR)
+				continue;
+
+			if (count <= 0)
+				return false;
+
+			written += count;
+		}
+
+		return true;
+	}
+
+	bool connection::read_all(void* buffer, const u64 size)
+	{
+		u8* bytes = static_cast<u8*>(buffer);
+		u64 read_count{0};
+		while (read_count < size)
+		{
+			const ssize_t count = recv(fd, bytes + read_count, size - read_count, 0);
+			if (count == -1 && errno == EINTR)
+				continue;
+
+			if (count <= 0)
+				return false;
+
+			read_count += count;
+		}
+
+		return true;
+	}
+
+	listener::listener(const std::string& address)
+	{
+		const socket_address addr = parse_address(address);
+
+		if (addr.is_unix)
+		{
+			// a socket file left behind by an earlier coordinator would make
+			// the bind fail, but anything else at the path is left alone
+			std::error_code error;
+			if (std::filesystem::is_socket(addr.path, error))
+				std::filesystem::remove(addr.path, error);
+
+			const sockaddr_un un = unix_socket_address(addr.path);
+			fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+			if (fd == -1 || bind(fd, reinterpret_cast<const sockaddr*>(&un), sizeof(un)) == -1 || listen(fd, SOMAXCONN) == -1)
+				fatal_error(std::format("could not listen on '{}': {}", address, std::strerror(errno)));
+
+			unix_path = addr.path;
+			return;
+		}
+
+		addrinfo* const candidates = resolve(addr, true);
+		fd = -1;
+		i32 err{0};
+		for (addrinfo* ai = candidates; ai && fd == -1; ai = ai->ai_next)
+		{
+			fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+			if (fd == -1)
+				continue;
+
+			// a restarted coordinator shouldn't have to wait for
+			// the connections of the earlier one to time out
+			const i32 enabled{1};
+			setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enabled, sizeof(enabled));
+
+			if (bind(fd, ai->ai_addr, ai->ai_addrlen) == -1 || listen(fd, SOMAXCONN) == -1)
+			{
+				err = errno;
+				close(fd);
+				fd = -1;
+			}
+		}
+		freeaddrinfo(candidates);
+
+		if (fd == -1)
+			fatal_error(std::format("could not listen on '{}': {}", address, std::strerror(err)));
+	}
+
+	listener::~listener()
+	{
+		close(fd);
+
+		if (!unix_path.empty())
+			unlink(unix_path.c_str());
+	}
+
+	i32 listener::accept(const u64 timeout_ms)
+	{
+		pollfd pfd{ fd, POLLIN, 0 };
+		if (poll(&pfd, 1, timeout_ms) <= 0)
+			return -1;
+
+		const i32 connection_fd = accept4(fd, nullptr, nullptr, SOCK_CLOEXEC);
+		if (connection_fd != -1 && unix_path.empty())
+			disable_nagle(connection_fd);
+
+		return connection_fd;
+	}
+
+	message_writer& message_writer::put(const u64 value)
+	{
+		const u8* bytes = reinterpret_cast<const u8*>(&value);
+		buffer.insert(buffer.end(), bytes, bytes + sizeof(value));
+		return *this;
+	}
+
+	message_writer& message_writer::put_bytes(const std::span<const u8> bytes)
+	{
+		put(bytes.size());
+		buffer.insert(buffer.end(), bytes.begin(), bytes.end());
+		return *this;
+	}
+
+	message_writer& message_writer::put_values(const std::span<const u64> values)
+	{
+		return put_bytes({ reinterpret_cast<const u8*>(values.data()), values.size_bytes() });
+	}
+
+	const std::vector<u8>& message_writer::bytes() const noexcept
+	{
+		return buffer;
+	}
+
+	message_reader::message_reader(const std::span<const u8> payload)
+	:payload(payload)
+	{}
+
+	u64 message_reader::get()
+	{
+		u64 value{0};
+		if (payload.size() - offset < sizeof(value))
+		{
+			valid = false;
+			return 0;
+		}
+
+		std::memcpy(&value, payload.data() + offset, sizeof(value));
+		offset += sizeof(value);
+		return value;
+	}
+
+	std::vector<u8> message_reader::get_bytes()
+	{
+		const u64 size = get();
+		if (payload.size() - offset < size)
+		{
+			valid = false;
+			return {};
+		}
+
+		std::vector<u8> bytes(payload.begin() + offset, payload.begin() + offset + size);
+		offset += size;
+		return bytes;
+	}
+
+	std::vector<u64> message_reader::get_values()
+	{
+		const std::vector<u8> bytes = get_bytes();
+		if (bytes.size() % sizeof(u64) != 0)
+		{
+			valid = false;
+			return {};
+		}
+
+		std::vector<u64> values(bytes.size() / sizeof(u64));
+		std::memcpy(values.data(), bytes.data(), bytes.size());
+		return values;
+	}
+
+	bool message_reader::good() const noexcept
+	{
+		return valid;
+	}
+}
@@ -0,0 +1,191 @@
+#include "coordinator.hpp"
+
+#include <algorithm>
+
+namespace fuzz
+{
+	namespace protocol = coordinator_protocol;
+
+	// the findings are only a handful of fingerprints
+	constexpr u64 finding_set_memory = 1024 * 1024;
+
+	coordinator::coordinator(const std::string& address, const protocol::campaign& c, const checkpoint& baseline,
+		const u64 first_unit, const u64 unit_limit, const u64 unit_batches,
+		const finding_fn& on_finding, const report_fn& on_report)
+	:socket(address), campaign(c), baseline_payload(protocol::encode(baseline)),
+	 unit_limit(unit_limit), unit_batches(unit_batches), on_finding(on_finding), on_report(on_report),
+	 next_first(first_unit), findings(finding_set_memory)
+	{}
+
+	coordinator::~coordinator()
+	{
+		// the threads are blocked on receiving, so the connections
+		// get shut down to wake them up
+		std::lock_guard<std::mutex> lock(sessions_mutex);
+		for (std::unique_ptr<session>& s : sessions)
+			s->conn->shut_down();
+
+		for (std::unique_ptr<session>& s : sessions)
+			s->thread.join();
+	}
+
+	void coordinator::poll(const u64 timeout_ms)
+	{
+		reap_sessions();
+
+		const i32 fd = socket.accept(timeout_ms);
+		if (fd == -1)
+			return;
+
+		std::lock_guard<std::mutex> lock(sessions_mutex);
+		std::unique_ptr<session>& s = sessions.emplace_back(std::make_unique<session>());
+		s->conn = std::make_unique<connection>(fd);
+		s->thread = std::thread(&coordinator::serve, this, std::ref(*s));
+	}
+
+	void coordinator::stop()
+	{
+		stopping = true;
+	}
+
+	bool coordinator::finished()
+	{
+		// the units can also run out with --max-execs and --enumerate
+		const bool out_of_units = unit_limit != 0 && next_first >= unit_limit;
+		return (stopping || out_of_units) && worker_count() == 0;
+	}
+
+	u64 coordinator::worker_count()
+	{
+		std::lock_guard<std::mutex> lock(sessions_mutex);
+		return std::count_if(sessions.begin(), sessions.end(), [](const std::unique_ptr<session>& s) { return !s->done; });
+	}
+
+	u64 coordinator::next_unit() const noexcept
+	{
+		return next_first;
+	}
+
+	void coordinator::serve(session& s)
+	{
+		while (const std::optional<message> msg = s.conn->receive())
+			if (!handle(*s.conn, *msg))
+				break;
+
+		s.done = true;
+	}
+
+	bool coordinator::handle(connection& conn, const message& msg)
+	{
+		switch (msg.type)
+		{
+			case protocol::join:
+			{
+				const std::optional<protocol::campaign> c = protocol::decode_campaign(msg.payload);
+
+				std::string reason;
+				if (!c)
+					reason = "the worker is running a different version of the fuzzer";
+				else if (c->file_fingerprint != campaign.file_fingerprint || c->sections_fingerprint != campaign.sections_fingerprint)
+					reason = "the worker is fuzzing a different file or different sections";
+				else if (!(*c == campaign))
+					reason = "the worker is using a different mode or different enumeration settings";
+
+				if (!reason.empty())
+				{
+					conn.send(protocol::rejected, { reinterpret_cast<const u8*>(reason.data()), reason.size() });
+					return false;
+				}
+
+				return conn.send(protocol::baseline, baseline_payload);
+			}
+
+			case protocol::request_unit:
+			{
+				// the units are sized by the job count of the worker
+				message_reader reader(msg.payload);
+				const u64 jobs = reader.get();
+				if (!reader.good())
+					return false;
+
+				std::unique_lock<std::mutex> lock(state_mutex);
+				const u64 first = next_first;
+				u64 count = std::max<u64>(jobs, 1) * unit_batches;
+				if (unit_limit != 0)
+					count = first < unit_limit ? std::min(count, unit_limit - first) : 0;
+
+				if (stopping || count == 0)
+				{
+					lock.unlock();
+					return conn.send(protocol::stop);
+				}
+
+				next_first = first + count;
+				lock.unlock();
+
+				return conn.send(protocol::unit, protocol::encode(protocol::work_unit{ first, count }));
+			}
+
+			case protocol::report:
+			{
+				const std::optional<protocol::unit_report> report = protocol::decode_unit_report(msg.payload);
+				if (!report)
+					return false;
+
+				std::lock_guard<std::mutex> lock(state_mutex);
+				on_report(*report);
+				return true;
+			}
+
+			case protocol::finding:
+			{
+				const std::optional<protocol::finding_record> f = protocol::decode_finding_record(msg.payload);
+				if (!f)
+					return false;
+
+				// the same patch can come up on several workers, only
+				// the first one to report it gets through
+				const u64 hash = fingerprint(fingerprint(f->p), { reinterpret_cast<const u8*>(&f->kind), sizeof(f->kind) });
+
+				std::lock_guard<std::mutex> lock(state_mutex);
+				if (findings.insert(hash) || f->minimized)
+					on_finding(*f);
+
+				return true;
+			}
+
+			case protocol::claim_minimization:
+			{
+				// only the first worker to stop at a finding gets to minimize
+				// it, and the rest of the workers are stopped after their
+				// current unit since the campaign is over
+				std::unique_lock<std::mutex> lock(state_mutex);
+				const u64 granted = !minimization_claimed;
+				minimization_claimed = true;
+				stopping = true;
+				lock.unlock();
+
+				return conn.send(protocol::claim_result, message_writer().put(granted).bytes());
+			}
+
+			default:
+				return false;
+		}
+	}
+
+	void coordinator::reap_sessions()
+	{
+		std::lock_guard<std::mutex> lock(sessions_mutex);
+
+		const auto finished_session = [](std::unique_ptr<session>& s)
+		{
+			if (!s->done)
+				return false;
+
+			s->thread.join();
+			return true;
+		};
+
+		sessions.erase(std::remove_if(sessions.begin(), sessions.end(), finished_session), sessions.end());
+	}
+}
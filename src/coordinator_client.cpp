@@ -0,0 +1,75 @@
+#include "coordinator_client.hpp"
+#include "io.hpp"
+
+#include <format>
+
+namespace fuzz
+{
+	namespace protocol = coordinator_protocol;
+
+	coordinator_client::coordinator_client(const std::string& address)
+	:conn(address)
+	{}
+
+	checkpoint coordinator_client::join(const protocol::campaign& c)
+	{
+		const std::optional<message> reply = request(protocol::join, protocol::encode(c));
+		if (!reply)
+			fatal_error("the coordinator closed the connection before the worker could join");
+
+		if (reply->type == protocol::rejected)
+			fatal_error(std::format("the coordinator turned the worker away: {}", std::string(reply->payload.begin(), reply->payload.end())));
+
+		const std::optional<checkpoint> baseline = protocol::decode_checkpoint(reply->payload);
+		if (reply->type != protocol::baseline || !baseline)
+			fatal_error("the coordinator sent a malformed baseline");
+
+		return *baseline;
+	}
+
+	std::optional<protocol::work_unit> coordinator_client::request_unit(const u64 jobs)
+	{
+		const std::optional<message> reply = request(protocol::request_unit, message_writer().put(jobs).bytes());
+		if (!reply || reply->type != protocol::unit)
+			return std::nullopt;
+
+		return protocol::decode_work_unit(reply->payload);
+	}
+
+	void coordinator_client::send_report(const protocol::unit_report& r)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		connected = connected && conn.send(protocol::report, protocol::encode(r));
+	}
+
+	void coordinator_client::send_finding(const protocol::finding_record& f)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		connected = connected && conn.send(protocol::finding, protocol::encode(f));
+	}
+
+	bool coordinator_client::claim_minimization()
+	{
+		const std::optional<message> reply = request(protocol::claim_minimization);
+		if (!reply || reply->type != protocol::claim_result)
+			return false;
+
+		message_reader reader(reply->payload);
+		return reader.get() != 0 && reader.good();
+	}
+
+	std::optional<message> coordinator_client::request(const u32 type, const std::span<const u8> payload)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if (!connected || !conn.send(type, payload))
+		{
+			connected = false;
+			return std::nullopt;
+		}
+
+		std::optional<message> reply = conn.receive();
+		connected = reply.has_value();
+		return reply;
+	}
+}
@@ -0,0 +1,205 @@
+#include "connection.hpp"
+#include "coordinator_protocol.hpp"
+
+namespace fuzz::coordinator_protocol
+{
+	// every field of the result gets sent, the coordinator
+	// prints and stores the findings just like the workers do
+	static void put_result(message_writer& writer, const cmd_res& res)
+	{
+		writer.put(static_cast<u64>(static_cast<i64>(res.return_value)))
+			.put(static_cast<u64>(static_cast<i64>(res.signal)))
+			.put(res.exec_time)
+			.put(res.spawn_time)
+			.put(res.patch_time)
+			.put(res.timed_out)
+			.put(res.max_rss_kb)
+			.put(res.user_time)
+			.put(res.system_time)
+			.put(res.minor_faults)
+			.put(res.major_faults)
+			.put(res.voluntary_switches)
+			.put(res.involuntary_switches)
+			.put(res.instructions)
+			.put(res.branches)
+			.put(res.page_faults);
+	}
+
+	static cmd_res get_result(message_reader& reader)
+	{
+		cmd_res res;
+		res.return_value = static_cast<i32>(reader.get());
+		res.signal = static_cast<i32>(reader.get());
+		res.exec_time = reader.get();
+		res.spawn_time = reader.get();
+		res.patch_time = reader.get();
+		res.timed_out = reader.get() != 0;
+		res.max_rss_kb = reader.get();
+		res.user_time = reader.get();
+		res.system_time = reader.get();
+		res.minor_faults = reader.get();
+		res.major_faults = reader.get();
+		res.voluntary_switches = reader.get();
+		res.involuntary_switches = reader.get();
+		res.instructions = reader.get();
+		res.branches = reader.get();
+		res.page_faults = reader.get();
+		return res;
+	}
+
+	std::vector<u8> encode(const campaign& c)
+	{
+		message_writer writer;
+		writer.put(hello)
+			.put(version)
+			.put(c.file_fingerprint)
+			.put(c.sections_fingerprint)
+			.put(c.mode)
+			.put(c.enumeration_width)
+			.put(c.value_order);
+		return writer.bytes();
+	}
+
+	std::vector<u8> encode(const checkpoint& c)
+	{
+		message_writer writer;
+		writer.put(c.file_fingerprint)
+			.put(c.sections_fingerprint)
+			.put(c.seed)
+			.put(c.execution_count)
+			.put_values(c.exec_time_samples)
+			.put_values(c.max_rss_kb_samples)
+			.put_values(c.cpu_time_samples)
+			.put_values(c.instruction_samples)
+			.put_values(c.section_executions)
+			.put_values(c.section_anomalies);
+		return writer.bytes();
+	}
+
+	std::vector<u8> encode(const work_unit& w)
+	{
+		message_writer writer;
+		writer.put(w.first).put(w.count);
+		return writer.bytes();
+	}
+
+	std::vector<u8> encode(const unit_report& r)
+	{
+		message_writer writer;
+		writer.put(r.executions)
+			.put_values(r.section_executions)
+			.put_values(r.section_anomalies)
+			.put_values(r.hotness);
+		return writer.bytes();
+	}
+
+	std::vector<u8> encode(const finding_record& f)
+	{
+		message_writer writer;
+		writer.put(f.p.address).put_bytes(f.p.bytes);
+		put_result(writer, f.res);
+		writer.put(static_cast<u64>(f.kind))
+			.put(f.v.reproductions)
+			.put(f.v.runs)
+			.put(f.time_result)
+			.put(f.ret_result)
+			.put(f.mem_result)
+			.put(f.minimized);
+		return writer.bytes();
+	}
+
+	std::optional<campaign> decode_campaign(const std::span<const u8> payload)
+	{
+		message_reader reader(payload);
+		if (reader.get() != hello || reader.get() != version)
+			return std::nullopt;
+
+		campaign c;
+		c.file_fingerprint = reader.get();
+		c.sections_fingerprint = reader.get();
+		c.mode = reader.get();
+		c.enumeration_width = reader.get();
+		c.value_order = reader.get();
+
+		if (!reader.good())
+			return std::nullopt;
+
+		return c;
+	}
+
+	std::optional<checkpoint> decode_checkpoint(const std::span<const u8> payload)
+	{
+		message_reader reader(payload);
+
+		checkpoint c;
+		c.file_fingerprint = reader.get();
+		c.sections_fingerprint = reader.get();
+		c.seed = reader.get();
+		c.execution_count = reader.get();
+		c.exec_time_samples = reader.get_values();
+		c.max_rss_kb_samples = reader.get_values();
+		c.cpu_time_samples = reader.get_values();
+		c.instruction_samples = reader.get_values();
+		c.section_executions = reader.get_values();
+		c.section_anomalies = reader.get_values();
+
+		if (!reader.good())
+			return std::nullopt;
+
+		return c;
+	}
+
+	std::optional<work_unit> decode_work_unit(const std::span<const u8> payload)
+	{
+		message_reader reader(payload);
+
+		work_unit w;
+		w.first = reader.get();
+		w.count = reader.get();
+
+		if (!reader.good())
+			return std::nullopt;
+
+		return w;
+	}
+
+	std::optional<unit_report> decode_unit_report(const std::span<const u8> payload)
+	{
+		message_reader reader(payload);
+
+		unit_report r;
+		r.executions = reader.get();
+		r.section_executions = reader.get_values();
+		r.section_anomalies = reader.get_values();
+		r.hotness = reader.get_values();
+
+		if (!reader.good() || r.section_executions.size() != r.section_anomalies.size())
+			return std::nullopt;
+
+		return r;
+	}
+
+	std::optional<finding_record> decode_finding_record(const std::span<const u8> payload)
+	{
+		message_reader reader(payload);
+
+		finding_record f;
+		f.p.address = reader.get();
+		f.p.bytes = reader.get_bytes();
+		f.res = get_result(reader);
+
+		const u64 kind = reader.get();
+		f.kind = static_cast<anomaly>(kind);
+		f.v.reproductions = reader.get();
+		f.v.runs = reader.get();
+		f.time_result = reader.get() != 0;
+		f.ret_result = reader.get() != 0;
+		f.mem_result = reader.get() != 0;
+		f.minimized = reader.get() != 0;
+
+		if (!reader.good() || kind >= anomaly_names.size())
+			return std::nullopt;
+
+		return f;
+	}
+}
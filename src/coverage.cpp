@@ -0,0 +1,197 @@
+#include "coverage.hpp"
+#include "io.hpp"
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <mutex>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace fuzz
+{
+	constexpr u64 map_size = coverage_protocol::map_size;
+	constexpr u64 word_count = map_size / sizeof(u64);
+
+	// 16 bytes of the counters, the compiler turns the operations on
+	// these into vector instructions even without -O3 or -march
+	using u8x16 = u8 __attribute__((vector_size(16)));
+	using u64x2 = u64 __attribute__((vector_size(16)));
+
+	// the counters are checked a cache line at a time
+	constexpr u64 vectors_per_block = 4;
+	constexpr u64 block_size = vectors_per_block * sizeof(u8x16);
+	static_assert(map_size % block_size == 0);
+
+	static bool is_zero(const u8x16 v)
+	{
+		const u64x2 words = reinterpret_cast<u64x2>(v);
+		return (words[0] | words[1]) == 0;
+	}
+
+	// put the 16 hit counts into buckets, each bucket is a bit of its own
+	// so that the buckets of an edge can be or'd together
+	//
+	// the comparisons give masks of the counts that reach a threshold,
+	// and each bucket is the range between two of the thresholds
+	static u8x16 bucket_counts(const u8x16 counts)
+	{
+		const u8x16 ge1 = reinterpret_cast<u8x16>(counts >= 1);
+		const u8x16 ge2 = reinterpret_cast<u8x16>(counts >= 2);
+		const u8x16 ge3 = reinterpret_cast<u8x16>(counts >= 3);
+		const u8x16 ge4 = reinterpret_cast<u8x16>(counts >= 4);
+		const u8x16 ge8 = reinterpret_cast<u8x16>(counts >= 8);
+		const u8x16 ge16 = reinterpret_cast<u8x16>(counts >= 16);
+		const u8x16 ge32 = reinterpret_cast<u8x16>(counts >= 32);
+		const u8x16 ge128 = reinterpret_cast<u8x16>(counts >= 128);
+
+		return (ge1 & ~ge2 & 1)
+			| (ge2 & ~ge3 & 2)
+			| (ge3 & ~ge4 & 4)
+			| (ge4 & ~ge8 & 8)
+			| (ge8 & ~ge16 & 16)
+			| (ge16 & ~ge32 & 32)
+			| (ge32 & ~ge128 & 64)
+			| (ge128 & 128);
+	}
+
+	// how many of the bytes of the word weren't zero before but are now
+	static u64 new_edge_count(const u64 before, const u64 after)
+	{
+		u64 count{0};
+
+		for (u64 i = 0; i < sizeof(u64); ++i)
+		{
+			const u64 shift = i * 8;
+			if (((before >> shift) & 0xff) == 0 && ((after >> shift) & 0xff) != 0)
+				++count;
+		}
+
+		return count;
+	}
+
+	coverage_map::coverage_map()
+	{
+		// the fd is dup'd to the protocol fd for the command, the memfd
+		// itself stays close-on-exec so other workers' commands don't get it
+		fd = memfd_create("dos-fuzzer-coverage", MFD_CLOEXEC);
+		if (fd == -1 || ftruncate(fd, map_size) == -1)
+			fatal_error(std::format("could not create the coverage map: {}", std::strerror(errno)));
+
+		void* map = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (map == MAP_FAILED)
+			fatal_error(std::format("could not map the coverage map: {}", std::strerror(errno)));
+
+		data = static_cast<u8*>(map);
+	}
+
+	coverage_map::~coverage_map()
+	{
+		munmap(data, map_size);
+		close(fd);
+	}
+
+	i32 coverage_map::file_descriptor() const noexcept
+	{
+		return fd;
+	}
+
+	void coverage_map::clear()
+	{
+		std::memset(data, 0, map_size);
+	}
+
+	std::span<const u8> coverage_map::counters() const noexcept
+	{
+		return { data, map_size };
+	}
+
+	coverage::coverage()
+	:seen(std::make_unique<std::atomic<u64>[]>(word_count))
+	{}
+
+	bool coverage::merge(const std::span<const u8> counters)
+	{
+		assert(counters.size() == map_size);
+
+		bool new_coverage{false};
+
+		for (u64 offset = 0; offset < map_size; offset += block_size)
+		{
+			u8x16 vectors[vectors_per_block];
+			std::memcpy(vectors, counters.data() + offset, sizeof(vectors));
+
+			// most of the map is empty in every run, so an empty block
+			// is skipped with a single branch
+			if (is_zero(vectors[0] | vectors[1] | vectors[2] | vectors[3])) [[likely]]
+				continue;
+
+			for (u64 v = 0; v < vectors_per_block; ++v)
+			{
+				if (is_zero(vectors[v]))
+					continue;
+
+				const u64x2 buckets = reinterpret_cast<u64x2>(bucket_counts(vectors[v]));
+				const u64 first_word = (offset + v * sizeof(u8x16)) / sizeof(u64);
+
+				for (u64 j = 0; j < 2; ++j)
+				{
+					const u64 i = first_word + j;
+					if ((buckets[j] & ~seen[i].load(std::memory_order_relaxed)) == 0)
+						continue;
+
+					// another worker could have reached the same buckets in the
+					// meantime, only the one that sets the bits counts them
+					const u64 before = seen[i].fetch_or(buckets[j], std::memory_order_relaxed);
+					if ((buckets[j] & ~before) == 0)
+						continue;
+
+					new_coverage = true;
+					edges.fetch_add(new_edge_count(before, before | buckets[j]), std::memory_order_relaxed);
+				}
+			}
+		}
+
+		return new_coverage;
+	}
+
+	u64 coverage::edge_count() const noexcept
+	{
+		return edges.load(std::memory_order_relaxed);
+	}
+
+	seed_pool::seed_pool(const u64 capacity)
+	:capacity(capacity)
+	{
+		assert(capacity > 0);
+	}
+
+	void seed_pool::add(const patch& p, const u64 section_index)
+	{
+		std::unique_lock lock(mutex);
+
+		if (seeds.size() < capacity)
+			seeds.push_back({ p, section_index });
+		else
+			seeds[next_index] = { p, section_index };
+
+		next_index = (next_index + 1) % capacity;
+	}
+
+	std::optional<seed> seed_pool::pick(rng& r) const
+	{
+		std::shared_lock lock(mutex);
+
+		if (seeds.empty())
+			return std::nullopt;
+
+		return seeds[r.below(seeds.size())];
+	}
+
+	u64 seed_pool::size() const
+	{
+		std::shared_lock lock(mutex);
+		return seeds.size();
+	}
+}
@@ -0,0 +1,94 @@
+#include "enumerator.hpp"
+#include "io.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <format>
+#include <numeric>
+
+namespace fuzz
+{
+	// boundaries of signed and unsigned integers, powers of two and
+	// ascii characters that often have a special meaning
+	constexpr std::array<u8, 24> interesting_values = {
+		0x00, 0xff, 0x7f, 0x80, 0x01, 0xfe, 0x81, 0x7e,
+		0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x64, 0xc0,
+		0xe0, 0xf0, 0x0f, 0x1f, 0x3f, 0x0a, 0x0d, 0x25
+	};
+
+	enumerator::enumerator(const std::span<const u8> orig_bytes, const std::vector<section>& sections, const u64 width, const value_order order)
+	:orig_bytes(orig_bytes), sections(sections), width(width)
+	{
+		if (width == 0 || width > max_enumeration_width)
+			fatal_error(std::format("the width of the enumerated window needs to be between 1 and {} bytes", max_enumeration_width));
+
+		for (const section& s : sections)
+		{
+			if (s.size < width)
+				fatal_error(std::format("the section at 0x{:x} is smaller than the enumerated window of {} bytes", s.address, width));
+
+			assert(s.end_address() <= orig_bytes.size());
+
+			window_count += s.size - width + 1;
+			cumulative_windows.push_back(window_count);
+		}
+
+		for (u64 i = 0; i < width; ++i)
+			value_count *= values.size();
+
+		std::iota(values.begin(), values.end(), 0);
+
+		// the interesting values are moved to the front in the same order
+		// they are listed in, the rest keep their ascending order
+		if (order == value_order::interesting_first)
+		{
+			std::stable_partition(values.begin(), values.end(), [](const u8 value)
+			{
+				return std::find(interesting_values.begin(), interesting_values.end(), value) != interesting_values.end();
+			});
+
+			std::copy(interesting_values.begin(), interesting_values.end(), values.begin());
+		}
+	}
+
+	u64 enumerator::size() const noexcept
+	{
+		return window_count * value_count;
+	}
+
+	std::optional<patch> enumerator::candidate(const u64 index) const
+	{
+		assert(index < size());
+
+		patch p{ window_address(index), std::vector<u8>(width) };
+
+		// every byte of the window is a digit of the value number, the
+		// first byte changes the fastest
+		u64 value_index = index / window_count;
+		for (u8& byte : p.bytes)
+		{
+			byte = values[value_index % values.size()];
+			value_index /= values.size();
+		}
+
+		if (std::equal(p.bytes.begin(), p.bytes.end(), orig_bytes.begin() + p.address))
+			return std::nullopt;
+
+		return p;
+	}
+
+	u64 enumerator::section_index(const u64 index) const
+	{
+		const u64 window = index % window_count;
+		return std::upper_bound(cumulative_windows.begin(), cumulative_windows.end(), window) - cumulative_windows.begin();
+	}
+
+	u64 enumerator::window_address(const u64 index) const
+	{
+		const u64 window = index % window_count;
+		const u64 i = section_index(index);
+		const u64 windows_before = i == 0 ? 0 : cumulative_windows[i - 1];
+
+		return sections[i].address + window - windows_before;
+	}
+}
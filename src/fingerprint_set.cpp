@@ -0,0 +1,129 @@
+#include "fingerprint_set.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+namespace fuzz
+{
+	// the table never gets smaller than this, even if the memory limit is tiny
+	constexpr u64 min_slot_count = 1024;
+
+	// the table is considered full at 70% load
+	constexpr u64 max_load_percent = 70;
+
+	// finalizer of splitmix64, mixes all of the input bits into all of the output bits
+	static constexpr u64 mix(u64 x) noexcept
+	{
+		x ^= x >> 30;
+		x *= 0xbf58476d1ce4e5b9;
+		x ^= x >> 27;
+		x *= 0x94d049bb133111eb;
+		x ^= x >> 31;
+		return x;
+	}
+
+	u64 fingerprint(const u64 key, const std::span<const u8> bytes) noexcept
+	{
+		// the length is mixed in so that trailing zero bytes change the result
+		u64 hash = mix(key ^ mix(bytes.size() + 0x9e3779b97f4a7c15));
+
+		u64 i = 0;
+		for (; i + sizeof(u64) <= bytes.size(); i += sizeof(u64))
+		{
+			u64 chunk;
+			std::memcpy(&chunk, bytes.data() + i, sizeof(u64));
+			hash = mix(hash ^ chunk);
+		}
+
+		if (i < bytes.size())
+		{
+			u64 chunk{0};
+			std::memcpy(&chunk, bytes.data() + i, bytes.size() - i);
+			hash = mix(hash ^ chunk);
+		}
+
+		return hash == 0 ? 1 : hash;
+	}
+
+	u64 fingerprint(const patch& p) noexcept
+	{
+		return fingerprint(p.address, p.bytes);
+	}
+
+	fingerprint_set::fingerprint_set(const u64 memory_limit_bytes)
+	:slots(std::max(std::bit_floor(memory_limit_bytes / sizeof(u64)), min_slot_count)),
+	 mask(slots.size() - 1),
+	 max_size(slots.size() * max_load_percent / 100)
+	{}
+
+	bool fingerprint_set::insert(const u64 fingerprint) noexcept
+	{
+		for (u64 i = fingerprint & mask; ; i = (i + 1) & mask)
+		{
+			u64 slot = slots[i].load(std::memory_order_relaxed);
+
+			if (slot == fingerprint)
+				return false;
+
+			if (slot != 0)
+				continue;
+
+			// reserve room for the fingerprint before taking the slot so
+			// that the table never gets fuller than the max size
+			if (count.fetch_add(1, std::memory_order_relaxed) >= max_size)
+			{
+				count.fetch_sub(1, std::memory_order_relaxed);
+				return true;
+			}
+
+			if (slots[i].compare_exchange_strong(slot, fingerprint, std::memory_order_relaxed))
+				return true;
+
+			// another worker took the slot first
+			count.fetch_sub(1, std::memory_order_relaxed);
+
+			if (slot == fingerprint)
+				return false;
+		}
+	}
+
+	bool fingerprint_set::contains(const u64 fingerprint) const noexcept
+	{
+		for (u64 i = fingerprint & mask; ; i = (i + 1) & mask)
+		{
+			const u64 slot = slots[i].load(std::memory_order_relaxed);
+
+			if (slot == fingerprint)
+				return true;
+
+			if (slot == 0)
+				return false;
+		}
+	}
+
+	std::vector<u64> fingerprint_set::fingerprints() const
+	{
+		std::vector<u64> result;
+		result.reserve(size());
+
+		for (const std::atomic<u64>& slot : slots)
+		{
+			const u64 value = slot.load(std::memory_order_relaxed);
+			if (value != 0)
+				result.push_back(value);
+		}
+
+		return result;
+	}
+
+	u64 fingerprint_set::size() const noexcept
+	{
+		return count.load(std::memory_order_relaxed);
+	}
+
+	bool fingerprint_set::is_full() const noexcept
+	{
+		return size() >= max_size;
+	}
+}
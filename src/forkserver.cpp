@@ -0,0 +1,201 @@
+#include "coverage_protocol.hpp"
+#include "forkserver.hpp"
+#include "forkserver_protocol.hpp"
+#include "io.hpp"
+#include "timer.hpp"
+
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <format>
+#include <iterator>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+extern char** environ;
+
+namespace fuzz
+{
+	namespace protocol = forkserver_protocol;
+
+	// the forkserver should be up and running way before this
+	constexpr u64 forkserver_startup_time_limit_ms = 10'000;
+
+	forkserver::forkserver(const command& cmd, const std::string& shim_path, const i32 stdin_fd, const i32 coverage_fd)
+	:stdin_fd(stdin_fd)
+	{
+		// the pipes are close-on-exec so that the other workers' processes
+		// don't keep them open, dup2 clears the flag for the target itself
+		i32 control_pipe[2];
+		i32 status_pipe[2];
+		if (pipe2(control_pipe, O_CLOEXEC) == -1 || pipe2(status_pipe, O_CLOEXEC) == -1)
+			fatal_error(std::format("could not create the forkserver pipes: {}", std::strerror(errno)));
+
+		// a source fd could be one of the fixed fds that an earlier dup2
+		// replaces, so all of them get copied out of the way first
+		const i32 target_fds[4] = { protocol::control_fd, protocol::status_fd, STDIN_FILENO, coverage_protocol::coverage_fd };
+		const i32 source_fds[4] = {
+			dup_above_fixed_fds(control_pipe[0]),
+			dup_above_fixed_fds(status_pipe[1]),
+			dup_above_fixed_fds(stdin_fd),
+			dup_above_fixed_fds(coverage_fd),
+		};
+
+		close(control_pipe[0]);
+		close(status_pipe[1]);
+
+		posix_spawn_file_actions_t file_actions;
+		posix_spawn_file_actions_init(&file_actions);
+		for (u64 i = 0; i < std::size(source_fds); ++i)
+		{
+			if (source_fds[i] != -1)
+				posix_spawn_file_actions_adddup2(&file_actions, source_fds[i], target_fds[i]);
+		}
+
+		// SIGPIPE is ignored by the fuzzer, but the target should get the default behaviour
+		sigset_t default_signals;
+		sigemptyset(&default_signals);
+		sigaddset(&default_signals, SIGPIPE);
+
+		// the forkserver gets a process group of its own so that a ctrl-c in the
+		// terminal only reaches the fuzzer, which then stops everything cleanly
+		posix_spawnattr_t attr;
+		posix_spawnattr_init(&attr);
+		posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGDEF);
+		posix_spawnattr_setpgroup(&attr, 0);
+		posix_spawnattr_setsigdefault(&attr, &default_signals);
+
+		// preload the shim on top of whatever was being preloaded already
+		std::vector<std::string> env_strings;
+		std::string ld_preload = "LD_PRELOAD=" + shim_path;
+		for (char** env = environ; *env; ++env)
+		{
+			if (std::strncmp(*env, "LD_PRELOAD=", 11) == 0)
+				ld_preload += std::format(":{}", *env + 11);
+			else
+				env_strings.push_back(*env);
+		}
+		env_strings.push_back(ld_preload);
+		env_strings.push_back(std::format("{}=1", protocol::enable_env));
+
+		std::vector<char*> env_ptrs;
+		for (std::string& env : env_strings)
+			env_ptrs.push_back(env.data());
+		env_ptrs.push_back(nullptr);
+
+		const i32 spawn_err = posix_spawnp(&pid, cmd.argv()[0], &file_actions, &attr, cmd.argv(), env_ptrs.data());
+		posix_spawn_file_actions_destroy(&file_actions);
+		posix_spawnattr_destroy(&attr);
+
+		for (const i32 fd : source_fds)
+		{
+			if (fd != -1)
+				close(fd);
+		}
+
+		if (spawn_err)
+			fatal_error(std::format("could not start the forkserver '{}': {}", cmd.argv()[0], std::strerror(spawn_err)));
+
+		control_fd = control_pipe[1];
+		status_fd = status_pipe[0];
+
+		if (!wait_for_fd(status_fd, deadline_after(forkserver_startup_time_limit_ms * 1'000'000)) || read_status() != protocol::hello)
+			fatal_error("the forkserver didn't start, is the shim library path correct?");
+	}
+
+	forkserver::~forkserver()
+	{
+		// closing the control pipe makes the forkserver exit on its own
+		close(control_fd);
+		close(status_fd);
+
+		kill(pid, SIGKILL);
+		waitpid(pid, nullptr, 0);
+	}
+
+	cmd_res forkserver::run(const exec_limits& limits)
+	{
+		timer t;
+		cmd_res res;
+
+		const timespec deadline = deadline_after(limits.time_limit_ns == no_time_limit ? 0 : limits.time_limit_ns);
+
+		// the children share the file offset with the fuzzer
+		if (stdin_fd != -1)
+			lseek(stdin_fd, 0, SEEK_SET);
+
+		t.start();
+
+		const u32 request = protocol::run_request;
+		const protocol::run_limits run_limits{ limits.cpu_limit_s, limits.memory_limit_mb };
+		if (write(control_fd, &request, sizeof(request)) != sizeof(request)
+				|| write(control_fd, &run_limits, sizeof(run_limits)) != sizeof(run_limits))
+			fatal_error("could not send a run request to the forkserver");
+
+		// the child is in its own process group and sets its resource limits
+		// before it continues to main, so it can be killed the same way as
+		// a command started by the spawner
+		const pid_t child_pid = read_status();
+		res.spawn_time = t.elapsed_nanos();
+
+		// the forkserver doesn't reap the child before the reap request, so
+		// the process group can be signalled until then
+		res.timed_out = wait_or_kill(child_pid, status_fd, deadline, limits);
+
+		if (read_status() != protocol::child_exited)
+			fatal_error("the forkserver sent an unexpected message");
+
+		const u32 reap = protocol::reap_request;
+		if (write(control_fd, &reap, sizeof(reap)) != sizeof(reap))
+			fatal_error("could not send a reap request to the forkserver");
+
+		const u32 status = read_status();
+
+		res.exec_time = t.elapsed_nanos();
+		set_exit_status(res, status);
+
+		protocol::child_usage usage;
+		read_exact(&usage, sizeof(usage));
+
+		res.max_rss_kb = usage.max_rss_kb;
+		res.user_time = usage.user_time_us * 1'000;
+		res.system_time = usage.system_time_us * 1'000;
+		res.minor_faults = usage.minor_faults;
+		res.major_faults = usage.major_faults;
+		res.voluntary_switches = usage.voluntary_switches;
+		res.involuntary_switches = usage.involuntary_switches;
+
+		return res;
+	}
+
+	void forkserver::read_exact(void* buffer, const u64 size)
+	{
+		u64 bytes_read{0};
+
+		while (bytes_read < size)
+		{
+			const ssize_t res = read(status_fd, static_cast<u8*>(buffer) + bytes_read, size - bytes_read);
+			if (res > 0)
+			{
+				bytes_read += res;
+				continue;
+			}
+
+			if (res == -1 && errno == EINTR)
+				continue;
+
+			fatal_error("the forkserver has stopped responding");
+		}
+	}
+
+	u32 forkserver::read_status()
+	{
+		u32 value;
+		read_exact(&value, sizeof(value));
+		return value;
+	}
+}
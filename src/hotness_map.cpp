@@ -0,0 +1,218 @@
+#include "hotness_map.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <format>
+#include <limits>
+
+namespace fuzz
+{
+	// the stats are kept for at most this many blocks
+	constexpr u64 max_block_count = 1 << 16;
+
+	// how many random start offsets compete for each patch
+	constexpr u64 start_candidates = 4;
+
+	// how many runs worth of the average rate every block starts with
+	constexpr f64 prior_executions = 16.0;
+
+	static u64 size_class(const u64 size)
+	{
+		assert(size > 0);
+		return std::min<u64>(std::bit_width(size - 1), 7);
+	}
+
+	// the smallest and the largest size in the class
+	static u64 size_class_min(const u64 c)
+	{
+		return c == 0 ? 1 : (1ull << (c - 1)) + 1;
+	}
+
+	static u64 size_class_max(const u64 c)
+	{
+		return c == 7 ? std::numeric_limits<u64>::max() : 1ull << c;
+	}
+
+	hotness_map::hotness_map(const std::span<const u8> orig_bytes)
+	:orig_bytes(orig_bytes)
+	{
+		while ((orig_bytes.size() >> block_shift) >= max_block_count)
+			++block_shift;
+
+		block_count = (orig_bytes.size() >> block_shift) + 1;
+		blocks = std::make_unique<block_stats[]>(block_count);
+	}
+
+	void hotness_map::record(const patch& p, const bool productive, const bool slow, const i64 cost_delta)
+	{
+		const auto add = [&](block_stats& stats)
+		{
+			stats.executions.fetch_add(1, std::memory_order_relaxed);
+			stats.productive.fetch_add(productive, std::memory_order_relaxed);
+			stats.slow.fetch_add(slow, std::memory_order_relaxed);
+			stats.cost_delta_sum.fetch_add(cost_delta, std::memory_order_relaxed);
+		};
+
+		// only the bytes that actually changed count, and
+		// each block only once per patch
+		u64 prev_block = block_count;
+		for (u64 i = 0; i < p.bytes.size(); ++i)
+		{
+			const u64 address = p.address + i;
+			const u64 block = address >> block_shift;
+			if (p.bytes[i] == orig_bytes[address] || block == prev_block)
+				continue;
+
+			add(blocks[block]);
+			prev_block = block;
+		}
+
+		add(size_classes[size_class(p.bytes.size())]);
+
+		total_executions.fetch_add(1, std::memory_order_relaxed);
+		total_productive.fetch_add(productive, std::memory_order_relaxed);
+	}
+
+	u64 hotness_map::pick_start(rng& r, const section& s, const u64 size) const
+	{
+		assert(size > 0 && size <= s.size);
+
+		const u64 start_count = s.size - size + 1;
+
+		// some of the patches go anywhere so that the
+		// quiet blocks still get tried every now and then
+		u64 best = s.address + r.below(start_count);
+		if (r.one_in(4))
+			return best;
+
+		f64 best_estimate = estimate(blocks[best >> block_shift]);
+		for (u64 i = 1; i < start_candidates; ++i)
+		{
+			const u64 start = s.address + r.below(start_count);
+			const f64 e = estimate(blocks[start >> block_shift]);
+			if (e > best_estimate)
+			{
+				best = start;
+				best_estimate = e;
+			}
+		}
+
+		return best;
+	}
+
+	u64 hotness_map::pick_size(rng& r, const u64 max_size) const
+	{
+		assert(max_size > 0);
+
+		const u64 class_count = size_class(max_size) + 1;
+
+		u64 c = r.below(class_count);
+		if (!r.one_in(4))
+		{
+			for (u64 i = 0; i < class_count; ++i)
+				if (estimate(size_classes[i]) > estimate(size_classes[c]))
+					c = i;
+		}
+
+		const u64 min_size = size_class_min(c);
+		const u64 max_class_size = std::min(size_class_max(c), max_size);
+		return min_size + r.below(max_class_size - min_size + 1);
+	}
+
+	std::string hotness_map::to_tsv() const
+	{
+		std::string tsv = "offset\tsize\texecutions\tproductive\tslow\tmean_cost_delta\n";
+
+		for (u64 i = 0; i < block_count; ++i)
+		{
+			const u64 executions = blocks[i].executions.load(std::memory_order_relaxed);
+			if (executions == 0)
+				continue;
+
+			const u64 offset = i << block_shift;
+			const u64 size = std::min<u64>(1ull << block_shift, orig_bytes.size() - offset);
+			tsv += std::format("0x{:x}\t{}\t{}\t{}\t{}\t{}\n", offset, size, executions,
+				blocks[i].productive.load(std::memory_order_relaxed),
+				blocks[i].slow.load(std::memory_order_relaxed),
+				blocks[i].cost_delta_sum.load(std::memory_order_relaxed) / static_cast<i64>(executions));
+		}
+
+		return tsv;
+	}
+
+	std::vector<u64> hotness_map::sparse_counts() const
+	{
+		std::vector<u64> counts;
+
+		// the patch lengths come after the blocks
+		for (u64 i = 0; i < block_count + size_class_count; ++i)
+		{
+			const block_stats& stats = i < block_count ? blocks[i] : size_classes[i - block_count];
+			const u64 executions = stats.executions.load(std::memory_order_relaxed);
+			if (executions == 0)
+				continue;
+
+			counts.insert(counts.end(), { i, executions,
+				stats.productive.load(std::memory_order_relaxed),
+				stats.slow.load(std::memory_order_relaxed),
+				static_cast<u64>(stats.cost_delta_sum.load(std::memory_order_relaxed)) });
+		}
+
+		return counts;
+	}
+
+	void hotness_map::merge(const std::span<const u64> counts)
+	{
+		constexpr u64 tuple_size = 5;
+
+		for (u64 i = 0; i + tuple_size <= counts.size(); i += tuple_size)
+		{
+			const u64 index = counts[i];
+			if (index >= block_count + size_class_count)
+				continue;
+
+			block_stats& stats = index < block_count ? blocks[index] : size_classes[index - block_count];
+			stats.executions.fetch_add(counts[i + 1], std::memory_order_relaxed);
+			stats.productive.fetch_add(counts[i + 2], std::memory_order_relaxed);
+			stats.slow.fetch_add(counts[i + 3], std::memory_order_relaxed);
+			stats.cost_delta_sum.fetch_add(static_cast<i64>(counts[i + 4]), std::memory_order_relaxed);
+
+			// every run has exactly one patch length
+			if (index >= block_count)
+			{
+				total_executions.fetch_add(counts[i + 1], std::memory_order_relaxed);
+				total_productive.fetch_add(counts[i + 2], std::memory_order_relaxed);
+			}
+		}
+	}
+
+	void hotness_map::clear()
+	{
+		const auto reset = [](block_stats& stats)
+		{
+			stats.executions = 0;
+			stats.productive = 0;
+			stats.slow = 0;
+			stats.cost_delta_sum = 0;
+		};
+
+		for (u64 i = 0; i < block_count; ++i)
+			reset(blocks[i]);
+
+		for (block_stats& stats : size_classes)
+			reset(stats);
+
+		total_executions = 0;
+		total_productive = 0;
+	}
+
+	f64 hotness_map::estimate(const block_stats& stats) const
+	{
+		const u64 total = total_executions.load(std::memory_order_relaxed);
+		const f64 average = total == 0 ? 0.0 : static_cast<f64>(total_productive.load(std::memory_order_relaxed)) / total;
+
+		return (stats.productive.load(std::memory_order_relaxed) + prior_executions * average)
+			/ (stats.executions.load(std::memory_order_relaxed) + prior_executions);
+	}
+}
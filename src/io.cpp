@@ -4,8 +4,8 @@
 #include <cassert>
 #include <cstdlib>
 #include <format>
-#include <format>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
 
 namespace fuzz
@@ -34,23 +34,6 @@ namespace fuzz
 		return bytes;
 	}
 
-	void write_bytes(const std::filesystem::path path, std::vector<u8>& bytes)
-	{
-		assert(!bytes.empty() && "the patched file ended up being empty");
-
-		if (std::filesystem::exists(path) && !std::filesystem::is_regular_file(path))
-		{
-			std::cout << path << " is a directory and not a file!\n";
-			abort();
-		}
-
-		// if the file exists already, get rid of it
-		std::filesystem::remove(path);
-
-		std::ofstream file(path);
-		file.write((char*)&bytes[0], bytes.size());
-	}
-
 	void print_spinner()
 	{
 		std::cout << "\033[2K\r[" << spinner_chars.at(++spinner_char_index % spinner_chars.size()) << ']' << std::flush;
@@ -61,24 +44,51 @@ namespace fuzz
 		std::cout << "\033[2K\r";
 	}
 
-	void print_result(const u64 address, const u64 byte_count, const std::vector<u8>& bytes, const cmd_res res)
+	std::string format_duration(const u64 ns)
 	{
-		assert(!bytes.empty());
-		assert(bytes.size() > address);
+		// show fractions of milliseconds only when they matter
+		if (ns >= 10'000'000)
+			return std::format("{}ms", ns / 1'000'000);
 
-		const std::string exec_info_str = std::format("{}{}ms", (res.return_value != 0 ? "ret " : ""), res.exec_time);
+		return std::format("{:.3f}ms", ns / 1'000'000.0);
+	}
+
+	void print_result(const patch& p, const cmd_res res, const bool print_usage, const std::string& note)
+	{
+		assert(!p.bytes.empty());
+
+		std::string exec_info_str;
+
+		if (res.timed_out)
+			exec_info_str = std::format("hang {}", format_duration(res.exec_time));
+		else if (res.signal != 0)
+			exec_info_str = std::format("sig {} {}", res.signal, format_duration(res.exec_time));
+		else
+			exec_info_str = std::format("{}{}", (res.return_value != 0 ? "ret " : ""), format_duration(res.exec_time));
+
+		std::cerr << std::hex << "0x" << p.address << " | " << std::left << std::setw(16) << exec_info_str << " | ";
+
+		if (print_usage)
+		{
+			std::string usage_str = std::format("rss {}MB cpu {}", res.max_rss_kb / 1024, format_duration(res.cpu_time()));
+			if (res.instructions != 0)
+				usage_str += std::format(" instr {:.2f}M", res.instructions / 1'000'000.0);
+
+			std::cerr << std::setw(res.instructions != 0 ? 38 : 24) << usage_str << " | ";
+		}
 
-		std::cerr << std::hex << "0x" << address << " | " << std::left << std::setw(10) << exec_info_str << " | ";
+		if (!note.empty())
+			std::cerr << std::setw(5) << note << " | ";
 
-		for (u64 i = address; i < address + byte_count; ++i)
-			std::fprintf(stderr, "%02x ", bytes.at(i));
+		for (const u8 byte : p.bytes)
+			std::fprintf(stderr, "%02x ", byte);
 
 		std::cerr << std::endl;
 	}
 
 	void fatal_error(const std::string& error_msg)
 	{
-		std::cout << "error: " << error_msg << '\n';
+		std::cout << "error: " << error_msg << std::endl;
 		abort();
 	}
 }
@@ -0,0 +1,69 @@
+#include "latency_model.hpp"
+
+#include <algorithm>
+
+namespace fuzz
+{
+	// scales the median absolute deviation to the standard deviation
+	// of a normal distribution
+	constexpr f64 mad_to_stddev = 1.4826;
+
+	// how many standard deviations above the median the early abort limit is
+	constexpr f64 early_abort_stddevs = 3.0;
+
+	latency_model::latency_model(const f32 variation_multiplier, const u64 min_margin_ns, const f64 min_margin_of_median)
+	:variation_multiplier(variation_multiplier),
+	 min_margin_ns(min_margin_ns),
+	 min_margin_of_median(min_margin_of_median)
+	{}
+
+	void latency_model::add_sample(const u64 exec_time_ns)
+	{
+		samples.add(exec_time_ns);
+	}
+
+	u64 latency_model::median() const noexcept
+	{
+		return samples.median();
+	}
+
+	u64 latency_model::p99() const noexcept
+	{
+		return samples.p99();
+	}
+
+	u64 latency_model::mad() const noexcept
+	{
+		return samples.mad();
+	}
+
+	std::vector<u64> latency_model::samples_snapshot() const
+	{
+		return samples.snapshot();
+	}
+
+	// the margin above the p99 never goes below a fraction of the median or
+	// the minimum margin, since very stable commands can have a MAD of zero
+	// and the scheduler of the machine can still cause some jitter
+	u64 latency_model::execution_time_limit() const noexcept
+	{
+		const u64 margin = std::max<u64>({
+			static_cast<u64>(variation_multiplier * mad_to_stddev * mad()),
+			static_cast<u64>(min_margin_of_median * median()),
+			min_margin_ns
+		});
+
+		return p99() + margin;
+	}
+
+	u64 latency_model::early_abort_limit() const noexcept
+	{
+		const u64 margin = std::max<u64>({
+			static_cast<u64>(early_abort_stddevs * mad_to_stddev * mad()),
+			static_cast<u64>(min_margin_of_median * median()),
+			min_margin_ns
+		});
+
+		return std::min(median() + margin, execution_time_limit());
+	}
+}
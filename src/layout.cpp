@@ -0,0 +1,169 @@
+#include "io.hpp"
+#include "layout.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <format>
+#include <fstream>
+#include <sstream>
+
+namespace fuzz
+{
+	// lookup table for the crc32 used by zlib, png and many others
+	static const std::array<u32, 256> crc32_table = []
+	{
+		std::array<u32, 256> table{};
+
+		for (u32 i = 0; i < table.size(); ++i)
+		{
+			u32 crc = i;
+			for (u8 bit = 0; bit < 8; ++bit)
+				crc = (crc & 1) ? (crc >> 1) ^ 0xedb88320 : crc >> 1;
+
+			table[i] = crc;
+		}
+
+		return table;
+	}();
+
+	static u32 crc32(const std::span<const u8> bytes)
+	{
+		u32 crc = 0xffffffff;
+
+		for (const u8 byte : bytes)
+			crc = crc32_table[(crc ^ byte) & 0xff] ^ (crc >> 8);
+
+		return crc ^ 0xffffffff;
+	}
+
+	static u32 adler32(const std::span<const u8> bytes)
+	{
+		constexpr u32 modulo = 65521;
+		u32 a = 1;
+		u32 b = 0;
+
+		for (const u8 byte : bytes)
+		{
+			a = (a + byte) % modulo;
+			b = (b + a) % modulo;
+		}
+
+		return (b << 16) | a;
+	}
+
+	static u64 parse_layout_hex(const std::string& str, const std::string& path)
+	{
+		try
+		{
+			return std::stoull(str, 0, 16);
+		}
+		catch (const std::exception& e)
+		{
+			fatal_error(std::format("'{}' in the layout file '{}' is not a valid hex string", str, path));
+		}
+	}
+
+	std::vector<field> read_layout_file(const std::string& path, const u64 file_size)
+	{
+		std::ifstream file(path);
+		if (!file.is_open())
+			fatal_error(std::format("could not open the layout file '{}'", path));
+
+		std::vector<field> fields;
+
+		std::string line;
+		while (std::getline(file, line))
+		{
+			std::stringstream stream(line);
+			std::string address_str, endianness_str, type_str;
+			u64 width{0};
+			stream >> address_str;
+
+			if (address_str.empty() || address_str.starts_with('#'))
+				continue;
+
+			stream >> width >> endianness_str >> type_str;
+
+			if (width != 1 && width != 2 && width != 4 && width != 8)
+				fatal_error(std::format("the field at {} in '{}' needs to be 1, 2, 4 or 8 bytes wide", address_str, path));
+
+			if (endianness_str != "le" && endianness_str != "be")
+				fatal_error(std::format("the endianness of the field at {} in '{}' needs to be le or be", address_str, path));
+
+			const auto type = std::find(field_type_names.begin(), field_type_names.end(), type_str);
+			if (type == field_type_names.end())
+				fatal_error(std::format("unknown field type '{}' in '{}'", type_str, path));
+
+			field f{ parse_layout_hex(address_str, path), width, endianness_str == "be", static_cast<field_type>(type - field_type_names.begin()) };
+
+			if (f.is_checksum())
+			{
+				std::string range_address_str, range_size_str;
+				stream >> range_address_str >> range_size_str;
+
+				if (range_size_str.empty())
+					fatal_error(std::format("the checksum at {} in '{}' is missing the range it covers", address_str, path));
+
+				if (f.width != 4)
+					fatal_error(std::format("the checksum at {} in '{}' needs to be 4 bytes wide", address_str, path));
+
+				f.checksum_address = parse_layout_hex(range_address_str, path);
+				f.checksum_size = parse_layout_hex(range_size_str, path);
+
+				if (f.checksum_address + f.checksum_size > file_size)
+					fatal_error(std::format("the range of the checksum at {} in '{}' goes past the end of the file", address_str, path));
+			}
+
+			if (f.end_address() > file_size)
+				fatal_error(std::format("the field at {} in '{}' goes past the end of the file", address_str, path));
+
+			fields.push_back(f);
+		}
+
+		return fields;
+	}
+
+	u64 read_field(const field& f, const std::span<const u8> bytes)
+	{
+		assert(f.end_address() <= bytes.size());
+
+		u64 value{0};
+
+		for (u64 i = 0; i < f.width; ++i)
+		{
+			const u64 shift = (f.big_endian ? f.width - 1 - i : i) * 8;
+			value |= static_cast<u64>(bytes[f.address + i]) << shift;
+		}
+
+		return value;
+	}
+
+	void write_field(const field& f, const std::span<u8> bytes, const u64 value)
+	{
+		assert(f.end_address() <= bytes.size());
+
+		for (u64 i = 0; i < f.width; ++i)
+		{
+			const u64 shift = (f.big_endian ? f.width - 1 - i : i) * 8;
+			bytes[f.address + i] = value >> shift;
+		}
+	}
+
+	u64 calculate_checksum(const field& f, const std::span<const u8> file_bytes)
+	{
+		const std::span<const u8> range = file_bytes.subspan(f.checksum_address, f.checksum_size);
+
+		switch (f.type)
+		{
+			case field_type::crc32:
+				return crc32(range);
+
+			case field_type::adler32:
+				return adler32(range);
+
+			default:
+				assert(0);
+				return 0;
+		}
+	}
+}
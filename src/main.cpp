@@ -1,403 +1,1307 @@
+#include <algorithm>
 #include <array>
-#include <cassert>
+#include <atomic>
+#include <csignal>
 #include <cstdio>
 #include <cstdlib>
 #include <filesystem>
+#include <format>
 #include <iostream>
-#include <map>
-#include <random>
-#include <unordered_map>
-#include <unordered_set>
+#include <mutex>
+#include <optional>
+#include <vector>
 
+#include "anomaly.hpp"
 #include "args.hpp"
 #include "cmd.hpp"
-#include "counter.hpp"
+#include "coordinator.hpp"
+#include "coordinator_client.hpp"
+#include "coverage.hpp"
+#include "enumerator.hpp"
+#include "fingerprint_set.hpp"
+#include "hotness_map.hpp"
 #include "io.hpp"
+#include "latency_model.hpp"
+#include "minimizer.hpp"
+#include "mutator.hpp"
+#include "output_dir.hpp"
+#include "reporter.hpp"
+#include "resource_model.hpp"
+#include "section_scheduler.hpp"
+#include "slowdown_population.hpp"
+#include "spawner.hpp"
+#include "stats.hpp"
 #include "timer.hpp"
+#include "worker_pool.hpp"
+
+// set by the first ctrl-c, the second one kills the fuzzer as usual
+static std::atomic<bool> interrupted{false};
+
+static void handle_interrupt(int)
+{
+	interrupted = true;
+	std::signal(SIGINT, SIG_DFL);
+}
 
 int main(int argc, char** argv)
 {
+	// the workers start the commands from copies of the fuzzer
+	// that never get past this point
+	fuzz::serve_as_spawner(argv);
+
 	// parsing CLI args is done in a separate compilation unit because
-	// clipp and std::regex have horrendous compile times
+	// clipp has horrendous compile times
 	const fuzz::opts opts = fuzz::parse_cli_args(argc, argv);
 
+	// writing into the stdin pipe of a command that has exited shouldn't kill the fuzzer
+	std::signal(SIGPIPE, SIG_IGN);
 
-	const u8 bytes_to_change = opts.section_size < opts.max_bytes_to_change ? opts.section_size : opts.max_bytes_to_change;
+	// stop the fuzzing loop cleanly on ctrl-c so that the checkpoint can be saved
+	std::signal(SIGINT, handle_interrupt);
 
 	// read in the original binary
 	std::vector<u8> orig_bytes = fuzz::read_bytes(opts.original_bin_path);
 
-	if (orig_bytes.size() < opts.section_address + opts.section_size)
+	for (const fuzz::section& s : opts.sections)
 	{
-		std::cout << "part of the defined section goes outside the bounds of the binary file\n";
-		return 1;
+		if (orig_bytes.size() < s.end_address())
+		{
+			std::cout << "part of the section at 0x" << std::hex << s.address << " goes outside the bounds of the binary file\n";
+			return 1;
+		}
+	}
+
+	const u64 file_fingerprint = fuzz::fingerprint(0, orig_bytes);
+	const u64 sections_fingerprint = fuzz::fingerprint(0, { reinterpret_cast<const u8*>(opts.sections.data()), opts.sections.size() * sizeof(fuzz::section) });
+
+	// findings and checkpoints are only stored if an output directory was given
+	std::optional<fuzz::output_dir> output;
+	std::optional<fuzz::checkpoint> resumed;
+	if (!opts.output_dir_path.empty())
+	{
+		output.emplace(opts.output_dir_path);
+
+		if (opts.resume)
+		{
+			resumed = output->load_checkpoint();
+
+			if (!resumed)
+				fuzz::fatal_error(std::format("there is no checkpoint to resume from in '{}'", opts.output_dir_path));
+
+			if (resumed->file_fingerprint != file_fingerprint || resumed->sections_fingerprint != sections_fingerprint)
+				fuzz::fatal_error("the checkpoint was made for a different file or different sections");
+		}
 	}
 
+	// a worker of a distributed campaign continues from the seed and the
+	// baselines of the coordinator as if it was resuming from a checkpoint
+	const fuzz::coordinator_protocol::campaign campaign{
+		file_fingerprint,
+		sections_fingerprint,
+		static_cast<u64>(opts.mode),
+		opts.enumeration_width,
+		static_cast<u64>(opts.value_order)
+	};
+
+	std::optional<fuzz::coordinator_client> client;
+	if (!opts.connect_address.empty())
+	{
+		client.emplace(opts.connect_address);
+		resumed = client->join(campaign);
+		std::cout << "joined the coordinator at " << opts.connect_address << '\n';
+	}
+
+	// seed the random number generators of the workers
+	//
+	// a resumed campaign keeps its seed, but the workers continue from a
+	// different point so that they don't generate the same patches again
+	const u64 seed = resumed ? resumed->seed : opts.seed == 0 ? std::chrono::high_resolution_clock::now().time_since_epoch().count() : opts.seed;
+	std::cout << "seed: " << seed << '\n';
+
+	std::atomic<u64> execution_count{resumed ? resumed->execution_count : 0};
+
+	// the coverage runtime in the command only maps the shared memory
+	// if it knows that the fuzzer has set it up
+	if (opts.coverage)
+		setenv(fuzz::coverage_protocol::enable_env, "1", 1);
+
+	fuzz::worker_pool pool(opts, orig_bytes, seed + execution_count);
+
+	// the edges that the original file reaches come from the dry runs, so
+	// only the patches that reach something else count as new coverage
+	fuzz::coverage coverage;
+
 	// execute the command a few times to figure out the expected runtime
+	//
+	// the dry runs are done with the worker pool so that the execution
+	// time is measured under the same load that the fuzzing happens in
+	fuzz::latency_model latency(opts.execution_time_variation_multiplier);
 
-	fuzz::timer t;
-	u64 longest_execution_time{0};
+	// the cpu time of the command is measured with a finer resolution and
+	// with less jitter than the wall clock time, so it gets a smaller margin
+	//
+	// the wall clock time is still needed for figuring out when to kill a
+	// command, which is why both models are always kept up to date
+	constexpr u64 cpu_time_min_margin_ns = 100'000;
+	fuzz::latency_model cpu_latency(opts.execution_time_variation_multiplier, cpu_time_min_margin_ns);
+
+	// the retired instructions only change a little bit from run to run,
+	// mostly because of address space layout randomization and the
+	// environment, so the margin can be much tighter
+	constexpr u64 instruction_min_margin = 10'000;
+	constexpr f64 instruction_min_margin_of_median = 0.02;
+	fuzz::latency_model instruction_latency(opts.execution_time_variation_multiplier, instruction_min_margin, instruction_min_margin_of_median);
+
+	// the model of the time metric that the execution time limit comes from
+	const fuzz::time_metric metric = opts.time_metric;
+	const fuzz::latency_model& metric_latency = metric == fuzz::time_metric::cpu ? cpu_latency
+		: metric == fuzz::time_metric::instructions ? instruction_latency
+		: latency;
+	fuzz::resource_model resources(opts.usage_ratio, opts.forkserver_shim_path.empty() && !fuzz::uses_spawner(opts));
+	std::atomic<bool> dry_run_failed{false};
+
+	if (resumed)
+	{
+		if (!client)
+			std::cout << "resuming from a checkpoint after " << std::dec << resumed->execution_count << " executions\n";
 
-	std::cout << "testing normal execution time with " << std::dec << (u32)opts.test_run_count << " runs\n";
-	for (u8 i = 0; i < opts.test_run_count; ++i)
+		for (const u64 sample : resumed->exec_time_samples)
+			latency.add_sample(sample);
+
+		for (u64 i = 0; i < std::min(resumed->max_rss_kb_samples.size(), resumed->cpu_time_samples.size()); ++i)
+			resources.add_sample(resumed->max_rss_kb_samples[i], resumed->cpu_time_samples[i]);
+
+		// the cpu time samples come from the same runs as the execution time samples
+		for (const u64 sample : resumed->cpu_time_samples)
+			cpu_latency.add_sample(sample);
+
+		for (const u64 sample : resumed->instruction_samples)
+			instruction_latency.add_sample(sample);
+	}
+
+	// the baselines of a resumed campaign come from the checkpoint, unless
+	// the instruction counts weren't used in the earlier campaign
+	if (!resumed || resumed->exec_time_samples.empty() || (metric == fuzz::time_metric::instructions && resumed->instruction_samples.empty()))
 	{
-		fuzz::cmd_res res = fuzz::run_cmd(opts.command_with_orig_bin);
+		std::cout << "testing normal execution time with " << std::dec << (u32)opts.test_run_count << " runs on " << pool.size() << " jobs\n";
+		pool.run(opts.test_run_count, [&](fuzz::worker& w, const u64)
+		{
+			// an empty patch leaves the file as it was
+			const fuzz::cmd_res res = w.execute({ opts.sections.front().address, {} }, fuzz::no_time_limit);
+
+			latency.add_sample(res.exec_time);
+			cpu_latency.add_sample(res.cpu_time());
+			resources.add_sample(res);
+
+			if (opts.perf_counters)
+				instruction_latency.add_sample(res.instructions);
+
+			if (opts.coverage)
+				coverage.merge(w.coverage_counters());
+
+			if (res.return_value || res.signal) [[unlikely]]
+				dry_run_failed = true;
+		});
+	}
 
-		if (res.exec_time > longest_execution_time)
-			longest_execution_time = res.exec_time;
+	if (dry_run_failed)
+	{
+		std::cout << "error!\n"
+			<< "running the command with the original binary has a non-zero return value\n";
+		return 1;
+	}
 
-		if (res.return_value) [[unlikely]]
+	// a resumed campaign doesn't do the dry runs, but the edges
+	// of the original file are still needed
+	if (opts.coverage && coverage.edge_count() == 0)
+	{
+		pool.run(1, [&](fuzz::worker& w, const u64)
 		{
-			std::cout << "error!\n"
-				<< "running the command with the original binary has a non-zero return value\n";
-			return 1;
-		}
+			w.execute({ opts.sections.front().address, {} }, fuzz::no_time_limit);
+			coverage.merge(w.coverage_counters());
+		});
+	}
+
+	if (opts.coverage)
+	{
+		if (coverage.edge_count() == 0)
+			std::cout << "warning: the command didn't report any coverage, is it linked with libdos-fuzzer-coverage.a?\n";
+		else
+			std::cout << "the original file reaches " << std::dec << coverage.edge_count() << " edges\n";
+	}
+
+	// the execution time limit allows for some extra time on top of the p99
+	// in case the program just happens to take a little bit longer sometimes
+	//
+	// the model keeps getting updated with normal runs during the fuzzing,
+	// so the limit follows the load of the machine
+	std::cout << "normal execution time: median " << fuzz::format_duration(latency.median())
+		<< ", p99 " << fuzz::format_duration(latency.p99())
+		<< ", MAD " << fuzz::format_duration(latency.mad()) << '\n';
+	std::cout << "execution time limit: " << fuzz::format_duration(latency.execution_time_limit()) << '\n';
+
+	if (metric == fuzz::time_metric::cpu)
+	{
+		std::cout << "normal cpu time: median " << fuzz::format_duration(cpu_latency.median())
+			<< ", p99 " << fuzz::format_duration(cpu_latency.p99())
+			<< ", MAD " << fuzz::format_duration(cpu_latency.mad()) << '\n';
+		std::cout << "cpu time limit: " << fuzz::format_duration(cpu_latency.execution_time_limit()) << '\n';
 	}
 
-	// allow for some extra time for the execution in case
-	// the program just happens to take a little bit longer sometimes
-	const u64 expected_execution_time = longest_execution_time * opts.execution_time_variation_multiplier;
-	std::cout << "longest normal execution time: " << longest_execution_time << "ms\n";
-	std::cout << "execution time limit: " << expected_execution_time << "ms\n";
+	if (metric == fuzz::time_metric::instructions)
+	{
+		std::cout << "normal instruction count: median " << instruction_latency.median()
+			<< ", p99 " << instruction_latency.p99()
+			<< ", MAD " << instruction_latency.mad() << '\n';
+		std::cout << "instruction limit: " << instruction_latency.execution_time_limit() << '\n';
+	}
 
+	std::cout << "normal resource usage: peak memory " << resources.median_max_rss_kb() / 1024 << "MB"
+		<< ", cpu time " << fuzz::format_duration(resources.median_cpu_time()) << '\n';
 
-	// seed the random number generator
-	const u64 seed = opts.seed == 0 ? std::chrono::high_resolution_clock::now().time_since_epoch().count() : opts.seed;
-	std::cout << "seed: " << seed << '\n';
-	std::srand(seed);
+	// the usage column has the cpu time and the instruction count in it
+	fuzz::reporter reporter(opts.mode == fuzz::mode::mem || metric != fuzz::time_metric::wall);
 
 	// if continuous mode is used, loop infinitely and try making different
 	// changes to the binary and see what happens
 	//
 	// if ret or time modes are used, stop at the first anomaly
-	std::cout << "fuzzing the binary section at 0x" << std::hex << opts.section_address << std::endl;
+	for (const fuzz::section& s : opts.sections)
+		std::cout << "fuzzing the binary section at 0x" << std::hex << s.address << " - 0x" << s.end_address() << '\n';
 
-	// if using something other than the continuous mode, store working bytes
-	// based on their locations into vectors
-	// they will then be randomly tried when looking for better areas
-	//
-	// shouldn't matter if the same byte appears multiple times at the same location
-	// afterall, that just means that that byte should be good at causing trouble
-	// and should be tried more often
-	std::unordered_map<u64, std::vector<u8>> byte_cache;
-
-	// these variables are stored outside the scope of the continuous loop
-	// since they are needed for the refining loop later on if the continuous mode is not used
-	u64 start_address{0};
-	u64 end_address{0};
+	std::cout << std::flush;
 
 	// helper function for checking if a return value is considered an error or not
 	const auto is_error_return = [&opts](const fuzz::cmd_res res) -> bool
 	{
-		if (opts.ignored_return_values.empty() && res.return_value != 0)
+		// commands that got killed for going over the time limit didn't crash
+		if (res.timed_out)
+			return false;
+
+		// getting killed by a signal is always an error
+		if (res.signal != 0)
 			return true;
 
-		return std::find(opts.ignored_return_values.begin(), opts.ignored_return_values.end(), res.return_value) != opts.ignored_return_values.end();
+		if (res.return_value == 0)
+			return false;
+
+		return std::find(opts.ignored_return_values.begin(), opts.ignored_return_values.end(), res.return_value) == opts.ignored_return_values.end();
 	};
 
-	while (true)
+	// the limit that the time mode compares the execution time against
+	const auto current_time_limit = [&]() -> u64
 	{
-		// print a spinner
-		// this should help with seeing if the program we are testing has frozen
-		fuzz::print_spinner();
+		return metric_latency.execution_time_limit();
+	};
 
-		const u64 byte_count = (std::rand() % (bytes_to_change - 1)) + 1;
-		const u64 start_byte = std::rand() % (opts.section_size - byte_count);
+	// the execution time, the cpu time or the instruction count depending on the time metric
+	const auto execution_cost = [metric](const fuzz::cmd_res res) -> u64
+	{
+		switch (metric)
+		{
+			case fuzz::time_metric::cpu:
+				return res.cpu_time();
 
-		std::vector<u8> patched_bytes = orig_bytes;
-		start_address = opts.section_address + start_byte;
-		end_address = opts.section_address + start_byte + byte_count;
+			case fuzz::time_metric::instructions:
+				return res.instructions;
 
-		for (u64 i = start_address; i < end_address; ++i)
-			patched_bytes.at(i) = std::rand() % 255;
+			default:
+				return res.exec_time;
+		}
+	};
 
-		// write the patched binary to disk
-		fuzz::write_bytes(opts.patched_bin_path, patched_bytes);
+	const auto normal_execution_cost = [&]() -> u64
+	{
+		return std::max<u64>(metric_latency.median(), 1);
+	};
 
-		// attempt to execute the command with the patched binary
-		fuzz::cmd_res res = fuzz::run_cmd(opts.command_with_patched_bin, expected_execution_time);
+	// helper function for checking if the command took abnormally long
+	const auto is_slow = [&execution_cost](const fuzz::cmd_res res, const u64 time_limit) -> bool
+	{
+		return res.timed_out || execution_cost(res) > time_limit;
+	};
 
-		const bool time_result = res.exec_time > expected_execution_time;
-		const bool ret_result = is_error_return(res);
-		if (time_result || ret_result)
-		{
-			// clear the spinner from the current line
-			fuzz::clear_cli_line();
+	// helper function for checking if the command used abnormally much memory or cpu time
+	const auto is_resource_heavy = [&resources](const fuzz::cmd_res res) -> bool
+	{
+		return resources.is_excessive(res);
+	};
 
-			fuzz::print_result(start_address, byte_count, patched_bytes, res);
+	// the slowdown mode is looking for slow patches that don't quite hang,
+	// so the commands only get killed when they are this many times
+	// slower than normal
+	constexpr u64 max_amplification = 100;
 
-			// if any other mode than continuous is used, stop right here
-			if (opts.mode != fuzz::mode::continuous && ((time_result && opts.mode == fuzz::mode::time) || (ret_result && opts.mode == fuzz::mode::ret)))
-			{
-				// cache the troublesome bytes
-				for (u64 i = start_address; i < end_address; ++i)
-					byte_cache[i].push_back(patched_bytes.at(i));
+	// in the mem mode and with the cpu time metric the commands need to be
+	// able to run long enough to go over the cpu time limit before they get
+	// killed, even if they don't get a cpu core all to themselves
+	//
+	// the instruction count can't be turned into a time limit, so the
+	// commands get twice the execution time limit to go over it
+	const auto kill_time_limit = [&](const u64 time_limit) -> u64
+	{
+		u64 limit = time_limit;
+		if (metric == fuzz::time_metric::cpu)
+			limit = latency.execution_time_limit() + time_limit;
+		else if (metric == fuzz::time_metric::instructions)
+			limit = latency.execution_time_limit() * 2;
 
-				break;
-			}
-		}
-	}
+		if (opts.mode == fuzz::mode::slowdown)
+			limit = std::max(limit, latency.median() * max_amplification);
 
-	std::cout << (opts.mode == fuzz::mode::time ? "long execution time" : "non-zero exit code") << " was encountered\n"
-		<< "starting to look for the minimal amount of changes needed for reproduction...\n";
+		return opts.mode == fuzz::mode::mem ? limit + resources.cpu_time_threshold() : limit;
+	};
 
-	// cache for holding byte combinations that have already been tried before
-	// to avoid doing duplicate work
+	// runs without anything abnormal about them keep the baselines up to date
 	//
-	// this is needed due to the byte_cache having a high risk of duplicate byte
-	// combinations when the search area becomes smaller
-	//
-	// the runtime of the program is very likely to be higher than hashing a string
-	// of a few bytes
-	std::unordered_map<u64, std::unordered_set<std::string>> patched_bytes_cache;
+	// most of the runs in the slowdown mode are slower than normal on purpose,
+	// so the baselines stay at what the dry runs measured
+	const auto update_baselines = [&](const fuzz::cmd_res res, const u64 time_limit)
+	{
+		if (opts.mode == fuzz::mode::slowdown)
+			return;
 
-	fuzz::counter patch_bytes_skip(opts.max_bytes_to_change);
+		if (res.return_value == 0 && res.signal == 0 && !is_slow(res, time_limit) && !is_resource_heavy(res))
+		{
+			latency.add_sample(res.exec_time);
+			cpu_latency.add_sample(res.cpu_time());
+			resources.add_sample(res);
 
-	// how many times we have had to do a loop skip because a singular
-	// byte ran out of combinations
-	fuzz::counter single_byte_skip(opts.max_bytes_to_change);
+			if (opts.perf_counters)
+				instruction_latency.add_sample(res.instructions);
+		}
+	};
 
-	// loop until we are down to a singular byte
-	u64 min_patch_size = end_address - start_address;
+	// helper function for checking if the results are what the selected mode is looking for
+	const auto matches_mode = [&opts](const bool time_result, const bool ret_result, const bool mem_result) -> bool
+	{
+		return (time_result && opts.mode == fuzz::mode::time)
+			|| (ret_result && opts.mode == fuzz::mode::ret)
+			|| (mem_result && opts.mode == fuzz::mode::mem);
+	};
 
-	// calculate a multiplier for the byte area size in the patching loop
-	// this should make it so that when the area gets smaller, the cached
-	// bytes are used less and less to favor entirely random bytes
+	// the kind of anomaly the run ran into, a crash that also took
+	// long to run is a crash first and foremost
 	//
-	// this should prevent exhausint byte combinations very early on
-	// due to only using cached bytes
-	const f32 byte_cache_rng_threshold = 1.0f / std::clamp(opts.max_bytes_to_change * 2.0f, 4.0f, 64.0f);
+	// the mem mode gives the commands time to go over the cpu time threshold
+	// before they get killed, so a killed command that used too much cpu time
+	// or memory is what the mode was looking for rather than a hang
+	const auto classify = [&](const fuzz::cmd_res res, const u64 time_limit) -> fuzz::anomaly
+	{
+		if (is_error_return(res))
+			return res.signal != 0 ? fuzz::anomaly::signal : fuzz::anomaly::exit_code;
+
+		if (opts.mode == fuzz::mode::mem && is_resource_heavy(res))
+			return fuzz::anomaly::resource_exhaustion;
+
+		if (res.timed_out)
+			return fuzz::anomaly::hang;
+
+		// the slowdown mode looks for slow runs on purpose, so only the
+		// runs that had to be killed count as anomalies there
+		if (opts.mode == fuzz::mode::slowdown)
+			return fuzz::anomaly::none;
+
+		if (is_slow(res, time_limit))
+			return fuzz::anomaly::slowdown;
+
+		if (is_resource_heavy(res))
+			return fuzz::anomaly::resource_exhaustion;
 
+		return fuzz::anomaly::none;
+	};
 
-	while (min_patch_size > 2)
+	// a slow run that didn't get killed the next time is still the
+	// same finding, it just happened to be closer to the limit
+	const auto same_anomaly = [](const fuzz::anomaly a, const fuzz::anomaly b) -> bool
 	{
-		fuzz::print_spinner();
-		std::cout << " search area: " << std::dec << end_address - start_address << " bytes" << std::flush;
+		const auto is_time = [](const fuzz::anomaly kind) { return kind == fuzz::anomaly::hang || kind == fuzz::anomaly::slowdown; };
+		return a == b || (is_time(a) && is_time(b));
+	};
+
+	// the stats are always collected for the heatmap, even if
+	// the patches are spread evenly over the sections
+	fuzz::hotness_map hotness(orig_bytes);
 
-		std::vector<u8> patched_bytes = orig_bytes;
+	fuzz::mutator mutator(orig_bytes, opts.max_bytes_to_change, opts.mutation_weights, opts.layout, opts.uniform_offsets ? nullptr : &hotness);
 
-		// spam random address ranges until we get something that has less
-		// bytes than the current minimum
-		//
-		// kind of a naive approach, but it shall do for now
+	// all of the sections share the same workers, the executions
+	// go to the sections that produce the most anomalies
+	fuzz::section_scheduler scheduler(opts.sections);
+
+	if (resumed && resumed->section_executions.size() == opts.sections.size() && resumed->section_anomalies.size() == opts.sections.size())
+	{
+		for (u64 i = 0; i < opts.sections.size(); ++i)
+			scheduler.restore(i, resumed->section_executions[i], resumed->section_anomalies[i]);
+	}
 
-		u64 min_start_address;
-		u64 min_end_address;
+	// fingerprints of the patches that have already been run, short patches
+	// come up again and again in small sections
+	fuzz::fingerprint_set tried_patches(opts.dedup_memory_mb * 1024 * 1024);
 
-		do
+	if (opts.resume)
+	{
+		for (const u64 fingerprint : output->load_tried_fingerprints())
+			tried_patches.insert(fingerprint);
+	}
+
+	const auto make_checkpoint = [&]() -> fuzz::checkpoint
+	{
+		std::vector<u64> section_executions(opts.sections.size());
+		std::vector<u64> section_anomalies(opts.sections.size());
+		for (u64 i = 0; i < opts.sections.size(); ++i)
 		{
-			// if the single_byte_skip_counter has reached its limit, stop
-			// generating areas that are only a singular byte in size
-			const u8 min_area_size = single_byte_skip.is_at_limit()
-				? 2
-				: 1;
+			section_executions[i] = scheduler.execution_count(i);
+			section_anomalies[i] = scheduler.anomaly_count(i);
+		}
+
+		return {
+			file_fingerprint,
+			sections_fingerprint,
+			seed,
+			execution_count,
+			latency.samples_snapshot(),
+			resources.max_rss_kb_snapshot(),
+			resources.cpu_time_snapshot(),
+			instruction_latency.samples_snapshot(),
+			section_executions,
+			section_anomalies
+		};
+	};
+
+	const auto save_checkpoint = [&]
+	{
+		if (output)
+			output->save_checkpoint(make_checkpoint(), tried_patches.fingerprints());
+	};
+
+	// long campaigns get checkpointed every now and then in case the
+	// fuzzer doesn't get to exit cleanly
+	constexpr u64 checkpoint_interval_ms = 60'000;
+	fuzz::timer checkpoint_timer;
+	checkpoint_timer.start();
+
+	// the first patch that caused the kind of anomaly the selected mode is looking for
+	std::optional<fuzz::patch> found_patch;
+	std::optional<fuzz::cmd_res> found_res;
+
+	// anomalies found during a batch, they only count as findings
+	// once they have been verified
+	struct pending_anomaly
+	{
+		fuzz::patch p;
+		fuzz::cmd_res res;
+		fuzz::anomaly kind;
+		u64 time_limit;
+		bool time_result;
+		bool ret_result;
+		bool mem_result;
+	};
+	std::vector<pending_anomaly> pending;
+	std::mutex pending_mutex;
+
+	constexpr u64 max_patch_attempts = 64;
+
+	fuzz::stats stats;
+
+	// the status line and the status file don't need to be
+	// updated after every single batch
+	constexpr u64 status_line_interval_ms = 250;
+	constexpr u64 stats_file_interval_ms = 5'000;
+	fuzz::timer status_line_timer;
+	fuzz::timer stats_file_timer;
+	status_line_timer.start();
+	stats_file_timer.start();
+	std::string status_line;
+
+	// the slowdown mode mutates the slowest patches found so far, patches
+	// need to be at least a little slower than normal to be worth keeping
+	constexpr u64 slowdown_population_size = 32;
+	constexpr f64 min_amplification = 1.1;
+	fuzz::slowdown_population population(slowdown_population_size);
+
+	// every time a new slowest patch is found, the amplification gets
+	// added to the curve so that the progress of the search can be seen
+	std::mutex slowest_mutex;
+	u64 slowest_cost{0};
+	std::string slowdown_curve = "executions\telapsed_ms\tcost_ns\tamplification\n";
+	fuzz::timer slowdown_timer;
+	slowdown_timer.start();
+
+	const auto save_heatmap = [&]
+	{
+		if (output)
+			output->save_heatmap(hotness.to_tsv());
+	};
+
+	const auto save_slowdown_curve = [&]
+	{
+		if (!output || opts.mode != fuzz::mode::slowdown)
+			return;
+
+		std::lock_guard<std::mutex> lock(slowest_mutex);
+		output->save_slowdown_curve(slowdown_curve);
+	};
+
+	// offer a patch to the population of the slowdown mode, returns true if it got in
+	const auto offer_slowdown = [&](fuzz::worker& w, const fuzz::patch& p, const u64 section_index, const fuzz::cmd_res res) -> bool
+	{
+		const u64 cost = execution_cost(res);
+		if (cost < normal_execution_cost() * min_amplification || cost <= population.admission_cost())
+			return false;
+
+		// a single slow run can be a scheduling hiccup, so the patch is
+		// run again and the faster one of the runs counts
+		const fuzz::cmd_res rerun = w.execute(p, kill_time_limit(current_time_limit()));
+		stats.record_execution(rerun);
+		++execution_count;
+
+		const u64 confirmed_cost = rerun.timed_out ? cost : std::min(cost, execution_cost(rerun));
+		if (!population.offer({ p, section_index, confirmed_cost }))
+			return false;
+
+		std::lock_guard<std::mutex> lock(slowest_mutex);
+		if (confirmed_cost > slowest_cost)
+		{
+			slowest_cost = confirmed_cost;
+
+			const f64 amplification = static_cast<f64>(confirmed_cost) / normal_execution_cost();
+			slowdown_curve += std::format("{}\t{}\t{}\t{:.2f}\n", execution_count.load(), slowdown_timer.elapsed_millis(), confirmed_cost, amplification);
 
-			min_start_address = start_address + (rand() % (end_address - start_address - min_area_size));
-			min_end_address = end_address - (rand() % (end_address - min_start_address));
+			const std::array<const char*, 3> metric_names = { "execution time", "cpu time", "instruction count" };
+			reporter.message(std::format("new slowest patch, {:.1f}x the normal {}\n", amplification, metric_names.at(static_cast<u64>(metric))));
+			reporter.report(p, res);
 
-		} while (min_end_address - min_start_address >= min_patch_size && min_end_address > min_start_address);
+			if (output)
+				output->save_finding(p, res);
 
-		assert(min_start_address < patched_bytes.size());
-		assert(min_end_address < patched_bytes.size());
-		assert(min_end_address - min_start_address > 0);
+			if (client)
+				client->send_finding({ p, res, fuzz::anomaly::none, {}, false, false, false, false });
+		}
 
-		// loop until a new combination of patches bytes that isn't in the
-		// patched_bytes_cache gets generated
-		//
-		// if a new combination cannot be found within a certain amount of attempts,
-		// loop around to attempt to get an address range that works better
-		//
-		// if this skip has to be done multiple times in a row, we'll stop
-		// the search entirely and call it quits because we can't come up
-		// with new combinations to try with in a reasonable amount of time
-		//
-		// at that point the amount of bytes left should be pretty small anyway
-		std::string byte_str;
+		return true;
+	};
 
-		fuzz::counter patch_bytes_loop(100'000);
+	// a single anomalous run can be a hiccup of the machine, so every
+	// anomaly is run again a few times in parallel and only the ones
+	// that keep running into the same kind of an anomaly get reported,
+	// stored and handed over to the minimizer
+	const auto verify_pending = [&]
+	{
+		const u64 runs = opts.verify_runs;
+		std::vector<fuzz::cmd_res> results(pending.size() * runs);
 
-		do
+		if (!results.empty())
 		{
-			patch_bytes_loop.increment();
+			reporter.print_spinner(std::format(" verifying {} anomal{}", pending.size(), pending.size() == 1 ? "y" : "ies"));
 
-			// start with a new byte string on each iteration
-			byte_str.clear();
+			pool.run(results.size(), [&](fuzz::worker& w, const u64 index)
+			{
+				const pending_anomaly& a = pending[index / runs];
+				results[index] = w.execute(a.p, kill_time_limit(a.time_limit));
+			});
+			execution_count += results.size();
+
+			for (const fuzz::cmd_res& res : results)
+				stats.record_execution(res);
+		}
 
-			// patch the bytes
-			for (u64 i = min_start_address; i < min_end_address; ++i)
+		for (u64 i = 0; i < pending.size(); ++i)
+		{
+			const pending_anomaly& a = pending[i];
+
+			fuzz::verification v{ 0, runs };
+			for (u64 j = 0; j < runs; ++j)
+				if (same_anomaly(classify(results[i * runs + j], a.time_limit), a.kind))
+					++v.reproductions;
+
+			if (!v.confirmed())
 			{
-				const f32 rng = rand() / static_cast<f32>(RAND_MAX);
-
-				// use the cached bytes randomly
-				//
-				// the less bytes there are left, the less the cache should be used
-				// since its faster to iterate through different random combinations
-				//
-				// also if the cache is used heavily with very few bytes left,
-				// there might be a lot of wasted rounds due to the same combination
-				// being tested multiple times
-				//
-				// if the patch_bytes_skip_counter has been touched, stop using the cache
-				if (patch_bytes_skip.has_incremented() && rng > (byte_cache_rng_threshold * (min_end_address - min_start_address)))
-				{
-					// instead of using the cached bytes directly, use the values around it
-					// to add some more variety
-					//
-					// this might cause an underflow or an overflow, but that shouldn't be a problem
-					//
-					// the cached bytes will be tried multiple times anyway, so the original
-					// value will still see a lot of use
-					const i8 cache_byte_fuzz = (rand() % 7) - 3;
-
-					patched_bytes.at(i) = byte_cache.at(i).at(rand() % byte_cache.at(i).size()) + cache_byte_fuzz;
-					continue;
-				}
+				stats.record_unconfirmed();
+				continue;
+			}
 
-				// try 00 and FF slightly more often if we haven't had to skip a loop yet
-				if (patch_bytes_skip.has_incremented() && rand() % 128 == 0)
-				{
-					patched_bytes.at(i) = rand() % 2 == 0 ? 0x00 : 0xFF;
-					continue;
-				}
+			stats.record_anomalies(a.ret_result, a.time_result, a.mem_result);
+			reporter.report(a.p, a.res, runs == 0 ? "" : std::format("{}/{}", v.reproductions, v.runs));
+			mutator.add_to_corpus(a.p);
+
+			if (output)
+				output->save_finding(a.p, a.res, a.kind, v);
+
+			if (client)
+				client->send_finding({ a.p, a.res, a.kind, v, a.time_result, a.ret_result, a.mem_result, false });
+
+			if (opts.mode == fuzz::mode::continuous || matches_mode(a.time_result, a.ret_result, a.mem_result))
+				stats.record_finding();
 
-				patched_bytes.at(i) = rand() % 256;
+			// if any other mode than continuous is used, stop after this round
+			if (matches_mode(a.time_result, a.ret_result, a.mem_result) && !found_patch)
+			{
+				found_patch = a.p;
+				found_res = a.res;
 			}
+		}
 
-			// copy the bytes into a string and use the unordered_set to hash it and cache it
-			// (assuming that it isn't already in the cache)
+		pending.clear();
+	};
 
-			std::copy(patched_bytes.begin() + min_start_address, patched_bytes.begin() + min_end_address, std::back_inserter(byte_str));
-		} while (patched_bytes_cache[min_start_address].contains(byte_str) && !patch_bytes_loop.is_at_limit());
+	// patches that reached new edges, most of the patches build on them
+	// when the coverage is being collected
+	constexpr u64 seed_pool_size = 1024;
+	fuzz::seed_pool seeds(seed_pool_size);
 
-		// we have had to loop around too many times, stop searching
-		if (patch_bytes_skip.is_at_limit())
+	const auto out_of_execs = [&]
+	{
+		return opts.max_execs != 0 && execution_count >= opts.max_execs;
+	};
+
+	// with --enumerate the patches come from going through every value
+	// of the windows in order instead of the mutator
+	std::optional<fuzz::enumerator> enumeration;
+	std::atomic<u64> next_candidate{0};
+
+	// the workers of a distributed campaign only go through the
+	// candidates of the unit that they are working on
+	u64 candidate_end{0};
+
+	if (opts.enumeration_width != 0)
+	{
+		enumeration.emplace(orig_bytes, opts.sections, opts.enumeration_width, opts.value_order);
+		candidate_end = client ? 0 : enumeration->size();
+		reporter.message(std::format("enumerating {} candidates with a window of {} byte{}\n",
+			enumeration->size(), opts.enumeration_width, opts.enumeration_width == 1 ? "" : "s"));
+	}
+
+	const auto enumeration_finished = [&]
+	{
+		return enumeration && !client && next_candidate >= enumeration->size();
+	};
+
+	// take the next candidate that hasn't been tried yet, the workers
+	// share the counter so every candidate gets run only once
+	const auto next_enumerated = [&](fuzz::patch& p, u64& section_index) -> bool
+	{
+		for (u64 index = next_candidate++; index < candidate_end; index = next_candidate++)
 		{
-			fuzz::clear_cli_line();
-			std::cout << "cannot come up with new byte combinations anymore in a reasonable amount of time\n"
-				<< "giving up (╯°□°）╯︵ ┻━┻\n";
-			break;
+			std::optional<fuzz::patch> candidate = enumeration->candidate(index);
+			if (!candidate || !tried_patches.insert(fuzz::fingerprint(*candidate)))
+				continue;
+
+			p = std::move(*candidate);
+			section_index = enumeration->section_index(index);
+			return true;
 		}
 
-		if (patch_bytes_loop.is_at_limit())
+		return false;
+	};
+
+	// a worker of a distributed campaign reports what it did to the
+	// coordinator after every unit, the stats of the addresses are kept
+	// in a map of their own so that only the new counts get sent
+	std::optional<fuzz::hotness_map> unit_hotness;
+	std::vector<u64> reported_section_executions(opts.sections.size());
+	std::vector<u64> reported_section_anomalies(opts.sections.size());
+	u64 reported_executions{execution_count};
+	u64 unit_patches_left{0};
+	bool coordinator_done{false};
+
+	if (client)
+	{
+		unit_hotness.emplace(orig_bytes);
+
+		for (u64 i = 0; i < opts.sections.size(); ++i)
 		{
-			// increment the skip counter only if the area we run out of combinations with
-			// was larger than a singular byte
-			//
-			// one byte only has 256 different combinations and exhasuting that list
-			// takes no effort at all; 2+ bytes should be a different story
-			if (min_end_address - min_start_address > 1)
-			{
-				if (!patch_bytes_skip.has_incremented())
-				{
-					fuzz::clear_cli_line();
-					std::cout << "running out of byte combinations to try\ndisabling byte cache...\n";
-				}
+			reported_section_executions[i] = scheduler.execution_count(i);
+			reported_section_anomalies[i] = scheduler.anomaly_count(i);
+		}
+	}
+
+	const auto send_report = [&]
+	{
+		const u64 executions = execution_count - reported_executions;
+		if (!client || executions == 0)
+			return;
+
+		fuzz::coordinator_protocol::unit_report report{ executions, {}, {}, unit_hotness->sparse_counts() };
+		for (u64 i = 0; i < opts.sections.size(); ++i)
+		{
+			report.section_executions.push_back(scheduler.execution_count(i) - reported_section_executions[i]);
+			report.section_anomalies.push_back(scheduler.anomaly_count(i) - reported_section_anomalies[i]);
+			reported_section_executions[i] = scheduler.execution_count(i);
+			reported_section_anomalies[i] = scheduler.anomaly_count(i);
+		}
+
+		client->send_report(report);
+		reported_executions += executions;
+		unit_hotness->clear();
+	};
+
+	const auto unit_finished = [&]
+	{
+		return enumeration ? next_candidate >= candidate_end : unit_patches_left == 0;
+	};
 
-				patch_bytes_skip.increment();
+	// report the last unit and get the next one, returns false
+	// once the coordinator has no more work to hand out
+	const auto next_unit = [&]() -> bool
+	{
+		send_report();
+
+		const std::optional<fuzz::coordinator_protocol::work_unit> unit = client->request_unit(pool.size());
+		if (!unit)
+			return false;
+
+		if (enumeration)
+		{
+			next_candidate = unit->first;
+			candidate_end = std::min(unit->first + unit->count, enumeration->size());
+		}
+		else
+		{
+			// the workers of the pool get the seeds at the start of the range
+			pool.reseed(seed + unit->first);
+			unit_patches_left = unit->count;
+		}
+
+		return true;
+	};
+
+	// the coordinator doesn't run any patches of its own, it hands out the
+	// work to the workers and collects what they find
+	if (!opts.listen_address.empty())
+	{
+		// the workers count their own executions, but they
+		// start from the same section weights as the coordinator
+		fuzz::checkpoint baseline = make_checkpoint();
+		baseline.execution_count = 0;
+
+		// with random mutations the units are ranges of seeds that continue
+		// from the executions so far, so a resumed coordinator doesn't hand
+		// out the same seeds again. the enumeration is split by the indices
+		// of its candidates
+		constexpr u64 unit_batches = 64;
+		const u64 first_unit = enumeration ? 0 : execution_count.load();
+		const u64 unit_limit = enumeration ? enumeration->size() : opts.max_execs;
+
+		const auto on_finding = [&](const fuzz::coordinator_protocol::finding_record& f)
+		{
+			if (f.minimized)
+			{
+				const u64 changed_count = fuzz::changed_offsets(f.p, orig_bytes).size();
+				reporter.message(std::format("a worker minimized the anomaly down to {} byte{} between 0x{:x} and 0x{:x}\n",
+					changed_count, changed_count == 1 ? "" : "s", f.p.address, f.p.end_address()));
 			}
 			else
 			{
-				if (!single_byte_skip.has_incremented())
+				stats.record_anomalies(f.ret_result, f.time_result, f.mem_result);
+
+				if (opts.mode == fuzz::mode::continuous || matches_mode(f.time_result, f.ret_result, f.mem_result))
+					stats.record_finding();
+			}
+
+			reporter.report(f.p, f.res, f.v.runs == 0 ? "" : std::format("{}/{}", f.v.reproductions, f.v.runs));
+
+			if (output)
+				output->save_finding(f.p, f.res, f.kind, f.v);
+		};
+
+		const auto on_report = [&](const fuzz::coordinator_protocol::unit_report& r)
+		{
+			execution_count += r.executions;
+			stats.record_executions(r.executions);
+
+			if (r.section_executions.size() == opts.sections.size())
+			{
+				for (u64 i = 0; i < opts.sections.size(); ++i)
 				{
-					fuzz::clear_cli_line();
-					std::cout << "giving up on finding a 1 byte solution\n";
+					scheduler.restore(i, scheduler.execution_count(i) + r.section_executions[i],
+						scheduler.anomaly_count(i) + r.section_anomalies[i]);
 				}
+			}
+
+			hotness.merge(r.hotness);
+		};
+
+		fuzz::coordinator coordinator(opts.listen_address, campaign, baseline, first_unit, unit_limit, unit_batches, on_finding, on_report);
+		reporter.message(std::format("waiting for workers on {}\n", opts.listen_address));
+
+		while (!coordinator.finished())
+		{
+			if (interrupted || out_of_execs())
+				coordinator.stop();
+
+			coordinator.poll(status_line_interval_ms);
+
+			status_line = stats.status_line() + std::format(" | {} workers", coordinator.worker_count());
+			if (enumeration)
+				status_line += std::format(" | {:.1f}% handed out", std::min<u64>(coordinator.next_unit(), enumeration->size()) * 100.0 / enumeration->size());
+
+			reporter.print_spinner(status_line);
+
+			if (output && stats_file_timer.elapsed_millis() >= stats_file_interval_ms)
+			{
+				output->save_stats(stats.to_json());
+				save_heatmap();
+				stats_file_timer.start();
+			}
 
-				single_byte_skip.increment();
+			if (checkpoint_timer.elapsed_millis() >= checkpoint_interval_ms)
+			{
+				save_checkpoint();
+				checkpoint_timer.start();
 			}
-			continue;
 		}
 
-		// cache the byte combination
-		patched_bytes_cache[min_start_address].insert(byte_str);
+		save_checkpoint();
+		save_heatmap();
+
+		if (output)
+			output->save_stats(stats.to_json());
+
+		reporter.message(std::format("{} after {} executions on the workers\n", interrupted ? "interrupted" : "stopped", execution_count.load()));
+
+		if (output)
+			reporter.message(std::format("{} findings and the checkpoint are in '{}'\n", output->finding_count(), opts.output_dir_path));
 
-		fuzz::write_bytes(opts.patched_bin_path, patched_bytes);
-		fuzz::cmd_res res = fuzz::run_cmd(opts.command_with_patched_bin, expected_execution_time);
+		reporter.flush();
+		return 0;
+	}
+
+	while (!found_patch && !interrupted && !out_of_execs() && !enumeration_finished())
+	{
+		// the workers of a distributed campaign stop once
+		// the coordinator has no more work for them
+		if (client && unit_finished() && !next_unit())
+		{
+			coordinator_done = true;
+			break;
+		}
 
-		const bool time_result = opts.mode == fuzz::mode::time && res.exec_time > expected_execution_time;
-		const bool ret_result = opts.mode == fuzz::mode::ret && is_error_return(res);
-		if (time_result || ret_result)
+		// print a spinner with the stats
+		// this should help with seeing if the program we are testing has frozen
+		if (status_line_timer.elapsed_millis() >= status_line_interval_ms)
 		{
-			fuzz::clear_cli_line();
+			status_line = stats.status_line();
+			status_line_timer.start();
+
+			if (enumeration)
+				status_line += std::format(" | {:.1f}% enumerated", std::min<u64>(next_candidate, enumeration->size()) * 100.0 / enumeration->size());
 
-			fuzz::print_result(min_start_address, min_end_address - min_start_address, patched_bytes, res);
-			min_patch_size = min_end_address - min_start_address;
+			reporter.print_spinner(status_line);
+		}
 
-			// nudge the search area to the hopefully correct direction by limiting it to
-			// the bytes around the latest result
-			//
-			// basically if the starting point of the found position is equal to the previously
-			// found point, we increase the search radius by one byte to that direction
-			//
-			// same goes for the end address aswell
-			//
-			// however if there are only 1-2 bytes left, don't make the area
-			// smaller so that it is easier to check for a 1 byte solution
-			if (min_patch_size > 2)
+		// each worker patches and runs a file of its own, anomalies
+		// are collected for verification after the batch
+		pool.run(pool.size(), [&](fuzz::worker& w, const u64)
+		{
+			fuzz::timer phase_timer;
+			phase_timer.start();
+
+			fuzz::patch p;
+			u64 section_index = scheduler.pick(w.rng);
+
+			// the last batch of the enumeration can have
+			// fewer candidates left than there are workers
+			if (enumeration && !next_enumerated(p, section_index))
+				return;
+
+			// most of the patches in the slowdown mode build on the slowest
+			// patches so far, the rest are new so that the search doesn't
+			// get stuck on the first slow patches it finds
+			std::optional<fuzz::slow_patch> parent;
+			if (opts.mode == fuzz::mode::slowdown && !enumeration && !w.rng.one_in(4))
+				parent = population.pick(w.rng);
+
+			// the same goes for the patches that reached new edges
+			std::optional<fuzz::seed> coverage_seed;
+			if (opts.coverage && !parent && !enumeration && !w.rng.one_in(4))
+				coverage_seed = seeds.pick(w.rng);
+
+			const fuzz::patch* base = parent ? &parent->p : coverage_seed ? &coverage_seed->p : nullptr;
+
+			if (parent)
+				section_index = parent->section_index;
+			else if (coverage_seed)
+				section_index = coverage_seed->section_index;
+
+			// generate a new patch if this one has already been tried, but
+			// don't get stuck if the section has been exhausted
+			for (u64 attempt = 0; attempt < max_patch_attempts && !enumeration; ++attempt)
 			{
-				start_address = start_address == min_start_address ? min_start_address - 1 : min_start_address;
-				end_address = end_address == min_end_address ? min_end_address + 1 : min_end_address;
+				if (base)
+					mutator.mutate_from(*base, p, w.rng, scheduler.sections()[section_index]);
+				else
+					mutator.mutate(p, w.rng, scheduler.sections()[section_index]);
+
+				if (tried_patches.insert(fuzz::fingerprint(p)))
+					break;
 			}
-			else
+
+			stats.record_phase(fuzz::phase::mutate, phase_timer.elapsed_nanos());
+
+			// attempt to execute the command with the patched binary
+			const u64 time_limit = current_time_limit();
+			const fuzz::cmd_res res = w.execute(p, kill_time_limit(time_limit));
+			stats.record_execution(res);
+
+			phase_timer.start();
+			update_baselines(res, time_limit);
+			++execution_count;
+
+			const bool new_edges = opts.coverage && coverage.merge(w.coverage_counters());
+			if (new_edges)
+				seeds.add(p, section_index);
+
+			// slow runs are the whole point of the slowdown mode, only the
+			// runs that had to be killed are reported as anomalies
+			const bool slowdown = opts.mode == fuzz::mode::slowdown;
+			const bool time_result = slowdown ? res.timed_out : is_slow(res, time_limit);
+			const bool ret_result = is_error_return(res);
+			const bool mem_result = !slowdown && is_resource_heavy(res);
+			const bool slower = slowdown && !res.timed_out && !ret_result && offer_slowdown(w, p, section_index, res);
+			const bool productive = time_result || ret_result || mem_result || slower || new_edges;
+			scheduler.record(section_index, productive);
+
+			const u64 cost = execution_cost(res);
+			const bool slow = !res.timed_out && cost > normal_execution_cost() * min_amplification;
+			hotness.record(p, productive, slow, static_cast<i64>(cost) - static_cast<i64>(normal_execution_cost()));
+
+			if (unit_hotness)
+				unit_hotness->record(p, productive, slow, static_cast<i64>(cost) - static_cast<i64>(normal_execution_cost()));
+
+			if (time_result || ret_result || mem_result)
 			{
-				start_address = min_start_address;
-				end_address = min_end_address;
+				std::lock_guard<std::mutex> lock(pending_mutex);
+				pending.push_back({ p, res, classify(res, time_limit), time_limit, time_result, ret_result, mem_result });
 			}
 
-			// cache the bytes at the new area
-			for (u64 i = start_address; i < end_address; ++i)
-				byte_cache[i].push_back(patched_bytes.at(i));
+			stats.record_phase(fuzz::phase::bookkeeping, phase_timer.elapsed_nanos());
+		});
+
+		if (!pending.empty())
+			verify_pending();
+
+		if (client && !enumeration)
+			unit_patches_left -= std::min<u64>(unit_patches_left, pool.size());
+
+		if (opts.coverage)
+			stats.record_coverage(coverage.edge_count(), seeds.size());
+
+		if (output && stats_file_timer.elapsed_millis() >= stats_file_interval_ms)
+		{
+			output->save_stats(stats.to_json());
+			save_slowdown_curve();
+			save_heatmap();
+			stats_file_timer.start();
+		}
+
+		if (checkpoint_timer.elapsed_millis() >= checkpoint_interval_ms)
+		{
+			save_checkpoint();
+			checkpoint_timer.start();
 		}
 	}
 
-	// if we were left with two bytes at the end, try all possible combinations
-	// (that haven't been tried before) to see if there would be a 1 byte solution
-	if (min_patch_size == 2)
+	send_report();
+	save_checkpoint();
+	save_slowdown_curve();
+	save_heatmap();
+
+	if (output)
+		output->save_stats(stats.to_json());
+
+	if (!found_patch)
 	{
-		std::cout << "trying all possible combinations to find a 1 byte solution\n" << std::flush;
-		std::string byte_str;
-		byte_str.resize(1);
+		const char* reason = interrupted ? "interrupted"
+			: coordinator_done ? "the coordinator has no more work"
+			: enumeration_finished() ? "every candidate was enumerated"
+			: "stopped";
+		reporter.message(std::format("{} after {} executions\n", reason, execution_count.load()));
 
-		const auto try_byte = [&opts, &orig_bytes, expected_execution_time, &is_error_return](const u64 addr, const u8 byte) -> bool
+		if (opts.mode == fuzz::mode::slowdown)
 		{
-			std::vector<u8> patched_bytes = orig_bytes;
-			patched_bytes.at(addr) = byte;
-			fuzz::write_bytes(opts.patched_bin_path, patched_bytes);
-			fuzz::cmd_res res = fuzz::run_cmd(opts.command_with_patched_bin, expected_execution_time);
+			constexpr u64 slowest_to_print = 5;
+			const std::vector<fuzz::slow_patch> slowest = population.snapshot();
 
-			const bool time_result = res.exec_time > expected_execution_time;
-			const bool ret_result = is_error_return(res);
+			reporter.message(slowest.empty() ? "no patches were slower than normal\n" : "the slowest patches:\n");
+			for (u64 i = 0; i < std::min(slowest.size(), slowest_to_print); ++i)
+			{
+				const u64 changed_count = fuzz::changed_offsets(slowest[i].p, orig_bytes).size();
+				reporter.message(std::format("{:.1f}x, {} byte{} changed between 0x{:x} and 0x{:x}\n",
+					static_cast<f64>(slowest[i].cost) / normal_execution_cost(), changed_count, changed_count == 1 ? "" : "s",
+					slowest[i].p.address, slowest[i].p.end_address()));
+			}
+		}
+
+		if (opts.sections.size() > 1)
+		{
+			for (u64 i = 0; i < opts.sections.size(); ++i)
+			{
+				reporter.message(std::format("section 0x{:x}: {} executions, {} anomalies\n",
+					opts.sections[i].address, scheduler.execution_count(i), scheduler.anomaly_count(i)));
+			}
+		}
+
+		if (output)
+			reporter.message(std::format("{} findings and the checkpoint are in '{}'\n", output->finding_count(), opts.output_dir_path));
+
+		reporter.flush();
+		return 0;
+	}
+
+	// only the ret, time and mem modes stop at an anomaly, but every mode
+	// has a name so that the lookup can't throw if that ever changes
+	const std::array<const char*, 5> anomaly_names = { "an anomaly", "non-zero exit code", "long execution time", "excessive resource usage", "slow execution" };
+
+	// only the first worker of a distributed campaign to stop at an
+	// anomaly minimizes it, the rest of the workers just stop
+	if (client && !client->claim_minimization())
+	{
+		reporter.message(std::format("{} was encountered, but another worker is already minimizing an anomaly\n", anomaly_names.at(opts.mode)));
+		reporter.flush();
+		return 0;
+	}
 
-			if (time_result || ret_result)
-				fuzz::print_result(addr, 1, patched_bytes, res);
+	reporter.message(std::format("{} was encountered\nstarting to look for the minimal amount of changes needed for reproduction...\n",
+		anomaly_names.at(opts.mode)));
 
-			return (time_result && opts.mode == fuzz::mode::time) || (ret_result && opts.mode == fuzz::mode::ret);
+	// the smallest reproduction so far, stored as a finding at the end
+	fuzz::patch reproduction_patch = *found_patch;
+	fuzz::cmd_res reproduction_res = *found_res;
+
+	// runs a batch of candidates in parallel with the given execution time limit
+	const auto run_candidates = [&](const std::vector<fuzz::patch>& candidates, const u64 time_limit) -> std::vector<fuzz::cmd_res>
+	{
+		reporter.print_spinner(std::format(" testing {} candidates", candidates.size()));
+
+		for (const fuzz::patch& candidate : candidates)
+			tried_patches.insert(fuzz::fingerprint(candidate));
+
+		std::vector<fuzz::cmd_res> results(candidates.size());
+		pool.run(candidates.size(), [&](fuzz::worker& w, const u64 index)
+		{
+			results[index] = w.execute(candidates[index], time_limit);
+		});
+		execution_count += candidates.size();
+
+		for (const fuzz::cmd_res& res : results)
+			stats.record_execution(res);
+
+		stats.record_minimization(candidates.size());
+
+		return results;
+	};
+
+	// runs a batch of candidates and reports the ones that reproduced the anomaly
+	//
+	// the minimizer keeps every reduction that reproduced, so a single noisy
+	// run would leave unneeded bytes in the result. the candidates that
+	// reproduced get verified the same way as the anomalies found while
+	// fuzzing, and only the ones that keep reproducing are accepted
+	const auto test_candidates = [&](const std::vector<fuzz::patch>& candidates) -> std::vector<bool>
+	{
+		const u64 time_limit = current_time_limit();
+		const std::vector<fuzz::cmd_res> results = run_candidates(candidates, kill_time_limit(time_limit));
+
+		for (const fuzz::cmd_res& res : results)
+			update_baselines(res, time_limit);
+
+		const auto reproduces = [&](const fuzz::cmd_res& res)
+		{
+			return matches_mode(is_slow(res, time_limit), is_error_return(res), is_resource_heavy(res));
 		};
 
-		// brute force both bytes until a solution is found
-		constexpr u8 bytes_to_bruteforce = 2;
-		for (u8 byte = 0; byte < bytes_to_bruteforce; ++byte)
+		std::vector<bool> reproduced(candidates.size());
+		std::vector<fuzz::patch> suspects;
+		std::vector<u64> suspect_indices;
+		for (u64 i = 0; i < candidates.size(); ++i)
 		{
-			std::cout << "byte[" << std::dec << (i32)byte << "] at 0x" << std::hex << start_address + byte << '\n';
+			reproduced[i] = reproduces(results[i]);
 
-			bool solution_found{false};
-			for (u16 i = 0; i < 256; ++i)
+			if (reproduced[i])
 			{
-				byte_str[0] = i;
+				for (u64 j = 0; j < opts.verify_runs; ++j)
+					suspects.push_back(candidates[i]);
 
-				if (patched_bytes_cache[start_address + byte].contains(byte_str))
-					continue;
+				suspect_indices.push_back(i);
+			}
+		}
 
-				solution_found = try_byte(start_address + byte, i);
+		if (!suspects.empty())
+		{
+			const std::vector<fuzz::cmd_res> rerun_results = run_candidates(suspects, kill_time_limit(time_limit));
 
-				if (solution_found)
-					break;
+			for (u64 i = 0; i < suspect_indices.size(); ++i)
+			{
+				fuzz::verification v{ 0, opts.verify_runs };
+				for (u64 j = 0; j < v.runs; ++j)
+					if (reproduces(rerun_results[i * v.runs + j]))
+						++v.reproductions;
+
+				reproduced[suspect_indices[i]] = v.confirmed();
+			}
+		}
+
+		// the minimizer continues with the first candidate that reproduced
+		// the anomaly, so that is the one that gets remembered
+		bool first_reproduction{true};
+
+		for (u64 i = 0; i < candidates.size(); ++i)
+		{
+			if (!reproduced[i])
+				continue;
+
+			reporter.report(candidates[i], results[i]);
+
+			if (first_reproduction)
+			{
+				reproduction_patch = candidates[i];
+				reproduction_res = results[i];
+				first_reproduction = false;
+			}
+		}
+
+		return reproduced;
+	};
+
+	// in the time mode every candidate that reproduces the anomaly would
+	// run until the execution time limit, which is far above the normal
+	// execution time if the baseline is noisy
+	//
+	// instead the candidates are killed at the early abort limit, and the
+	// ones that went over it are run again with the same limit to rule out
+	// scheduling hiccups. only the final result of the minimization is
+	// confirmed with the full execution time limit
+	const auto probe_candidates = [&](const std::vector<fuzz::patch>& candidates) -> std::vector<bool>
+	{
+		const u64 early_limit = latency.early_abort_limit();
+
+		// if there are enough idle workers, both runs of every
+		// candidate can be done in the same batch
+		if (candidates.size() * 2 <= pool.size())
+		{
+			std::vector<fuzz::patch> doubled = candidates;
+			doubled.insert(doubled.end(), candidates.begin(), candidates.end());
+
+			const std::vector<fuzz::cmd_res> results = run_candidates(doubled, early_limit);
+
+			std::vector<bool> reproduced(candidates.size());
+			for (u64 i = 0; i < candidates.size(); ++i)
+				reproduced[i] = is_slow(results[i], early_limit) && is_slow(results[i + candidates.size()], early_limit);
+
+			return reproduced;
+		}
+
+		const std::vector<fuzz::cmd_res> results = run_candidates(candidates, early_limit);
+
+		std::vector<fuzz::patch> suspects;
+		std::vector<u64> suspect_indices;
+		for (u64 i = 0; i < candidates.size(); ++i)
+		{
+			if (is_slow(results[i], early_limit))
+			{
+				suspects.push_back(candidates[i]);
+				suspect_indices.push_back(i);
 			}
+		}
+
+		std::vector<bool> reproduced(candidates.size());
+		if (suspects.empty())
+			return reproduced;
+
+		const std::vector<fuzz::cmd_res> rerun_results = run_candidates(suspects, early_limit);
+		for (u64 i = 0; i < suspects.size(); ++i)
+			reproduced[suspect_indices[i]] = is_slow(rerun_results[i], early_limit);
+
+		return reproduced;
+	};
+
+	// run a single patch with the full execution time limit
+	const auto confirm = [&](const fuzz::patch& p) -> bool
+	{
+		return test_candidates({ p }).front();
+	};
 
-			if (solution_found)
-				break;
+	// running a candidate twice with the early abort limit should take less
+	// time than running it once with the full limit, otherwise there is
+	// nothing to gain
+	//
+	// with the cpu time metric the commands get killed based on the wall
+	// clock time, so there is no early abort limit to use
+	const bool early_abort = opts.mode == fuzz::mode::time && metric == fuzz::time_metric::wall && latency.early_abort_limit() * 2 < latency.execution_time_limit();
+	const fuzz::batch_test_fn test = early_abort ? fuzz::batch_test_fn(probe_candidates) : fuzz::batch_test_fn(test_candidates);
+
+	fuzz::patch min_patch = fuzz::minimize_patch(*found_patch, orig_bytes, test);
+
+	if (early_abort && !confirm(min_patch))
+	{
+		reporter.message("the minimized patch didn't reproduce the anomaly with the full execution time limit, minimizing again without early aborts\n");
+		min_patch = fuzz::minimize_patch(*found_patch, orig_bytes, test_candidates);
+	}
+
+	const std::vector<u64> min_changes = fuzz::changed_offsets(min_patch, orig_bytes);
+
+	reporter.message(std::format("the anomaly can be reproduced by changing {} byte{} between 0x{:x} and 0x{:x}\n",
+		min_changes.size(), min_changes.size() == 1 ? "" : "s", min_patch.address, min_patch.end_address()));
+
+	// if we were left with two bytes at the end, try all possible values
+	// for both of them to see if there would be a 1 byte solution
+	if (min_changes.size() == 2)
+	{
+		reporter.message("trying all possible combinations to find a 1 byte solution\n");
+
+		// both of the bytes are enumerated at the same time, so the
+		// values that come first in the value order get tried at
+		// both of the addresses before the rest
+		std::vector<fuzz::section> windows;
+		for (const u64 offset : min_changes)
+			windows.push_back({ min_patch.address + offset, 1 });
+
+		const fuzz::enumerator single_bytes(orig_bytes, windows, 1, opts.value_order);
+
+		// the original values and the values in the minimized patch are
+		// already known to not be enough on their own, and the same goes
+		// for any values that have been tried before
+		std::vector<fuzz::patch> candidates;
+		for (u64 i = 0; i < single_bytes.size(); ++i)
+		{
+			const std::optional<fuzz::patch> candidate = single_bytes.candidate(i);
+			if (candidate && candidate->bytes.front() != min_patch.bytes.at(candidate->address - min_patch.address)
+					&& !tried_patches.contains(fuzz::fingerprint(*candidate)))
+				candidates.push_back(*candidate);
 		}
+
+		// try the bytes in batches of the worker count so that we can
+		// stop soon after a solution has been found
+		bool solution_found{false};
+		for (u64 batch_start = 0; batch_start < candidates.size() && !solution_found; batch_start += pool.size())
+		{
+			const u64 batch_size = std::min(pool.size(), candidates.size() - batch_start);
+			const std::vector<fuzz::patch> batch(candidates.begin() + batch_start, candidates.begin() + batch_start + batch_size);
+			const std::vector<bool> reproduced = test(batch);
+
+			// solutions found with early aborts need to be confirmed
+			for (u64 i = 0; i < batch.size() && !solution_found; ++i)
+				solution_found = reproduced[i] && (!early_abort || confirm(batch[i]));
+		}
+	}
+
+	if (output)
+	{
+		output->save_finding(reproduction_patch, reproduction_res, classify(reproduction_res, current_time_limit()));
+		output->save_stats(stats.to_json());
+		save_checkpoint();
 	}
 
+	if (client)
+	{
+		const u64 time_limit = current_time_limit();
+		send_report();
+		client->send_finding({ reproduction_patch, reproduction_res, classify(reproduction_res, time_limit), {},
+			is_slow(reproduction_res, time_limit), is_error_return(reproduction_res), is_resource_heavy(reproduction_res), true });
+	}
+
+	reporter.flush();
+
 	return 0;
 }
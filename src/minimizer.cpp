@@ -0,0 +1,130 @@
+#include "fingerprint_set.hpp"
+#include "minimizer.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace fuzz
+{
+	// the minimizer only runs a few hundred candidates at most
+	constexpr u64 tested_set_memory = 64 * 1024;
+
+	// a candidate for the next round and whether it is one of the subsets
+	// or a complement of one
+	struct configuration
+	{
+		std::vector<u64> offsets;
+		bool is_complement;
+	};
+
+	// build a patch that only has the given changed bytes of the original
+	// patch in it, everything in between is reverted to the original bytes
+	static patch patch_from_offsets(const patch& p, const std::span<const u8> orig_bytes, const std::vector<u64>& offsets)
+	{
+		assert(!offsets.empty());
+		assert(std::is_sorted(offsets.begin(), offsets.end()));
+
+		const u64 start = p.address + offsets.front();
+		const u64 end = p.address + offsets.back() + 1;
+
+		patch result{ start, std::vector<u8>(orig_bytes.begin() + start, orig_bytes.begin() + end) };
+
+		for (const u64 offset : offsets)
+			result.bytes.at(p.address + offset - start) = p.bytes.at(offset);
+
+		return result;
+	}
+
+	std::vector<u64> changed_offsets(const patch& p, const std::span<const u8> orig_bytes)
+	{
+		std::vector<u64> offsets;
+
+		for (u64 i = 0; i < p.bytes.size(); ++i)
+			if (p.bytes[i] != orig_bytes[p.address + i])
+				offsets.push_back(i);
+
+		return offsets;
+	}
+
+	patch minimize_patch(const patch& p, const std::span<const u8> orig_bytes, const batch_test_fn& test)
+	{
+		std::vector<u64> changes = changed_offsets(p, orig_bytes);
+
+		// nothing to minimize
+		if (changes.size() < 2)
+			return changes.empty() ? p : patch_from_offsets(p, orig_bytes, changes);
+
+		// the same subsets come up again after the granularity changes,
+		// there's no point in running them more than once
+		//
+		// the candidate patches are different for every set of changes,
+		// so their fingerprints can be used in place of the sets
+		fingerprint_set tested(tested_set_memory);
+
+		u64 granularity = 2;
+
+		while (changes.size() > 1)
+		{
+			granularity = std::min<u64>(granularity, changes.size());
+
+			// split the changes into roughly equally sized subsets
+			std::vector<std::vector<u64>> subsets(granularity);
+			for (u64 i = 0; i < changes.size(); ++i)
+				subsets[i * granularity / changes.size()].push_back(changes[i]);
+
+			// the subsets are tried first since they shrink the patch the most
+			//
+			// with only two subsets the complements are the subsets themselves
+			std::vector<configuration> configurations;
+			for (const std::vector<u64>& subset : subsets)
+				configurations.push_back({ subset, false });
+
+			if (granularity > 2)
+			{
+				for (const std::vector<u64>& subset : subsets)
+				{
+					std::vector<u64> complement;
+					std::set_difference(changes.begin(), changes.end(), subset.begin(), subset.end(), std::back_inserter(complement));
+					configurations.push_back({ complement, true });
+				}
+			}
+
+			// all of the configurations are run as a single batch so that
+			// every worker has something to do
+			std::vector<configuration> untested;
+			std::vector<patch> candidates;
+			for (configuration& c : configurations)
+			{
+				patch candidate = patch_from_offsets(p, orig_bytes, c.offsets);
+				if (!tested.insert(fingerprint(candidate)))
+					continue;
+
+				untested.push_back(std::move(c));
+				candidates.push_back(std::move(candidate));
+			}
+
+			const std::vector<bool> results = candidates.empty() ? std::vector<bool>{} : test(candidates);
+			assert(results.size() == candidates.size());
+
+			// continue with the first configuration that reproduced the anomaly,
+			// the order of the configurations keeps the result deterministic
+			const auto reproduced = std::find(results.begin(), results.end(), true);
+
+			if (reproduced != results.end())
+			{
+				const configuration& c = untested.at(reproduced - results.begin());
+				changes = c.offsets;
+				granularity = c.is_complement ? std::max<u64>(granularity - 1, 2) : 2;
+				continue;
+			}
+
+			// every byte has been tried on its own, the changes are 1-minimal
+			if (granularity == changes.size())
+				break;
+
+			granularity = std::min<u64>(granularity * 2, changes.size());
+		}
+
+		return patch_from_offsets(p, orig_bytes, changes);
+	}
+}
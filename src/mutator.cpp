@@ -0,0 +1,387 @@
+#include "mutator.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <mutex>
+
+namespace fuzz
+{
+	// the corpus for splicing only keeps this many patches, after that
+	// new patches replace the oldest ones
+	constexpr u64 max_corpus_size = 256;
+
+	// the arithmetic mutations add or subtract at most this much
+	constexpr u64 max_arithmetic_delta = 35;
+
+	// values that are likely to hit edge cases in parsers
+	constexpr std::array<u64, 9> interesting_8 = {
+		0x00, 0x01, 0x10, 0x20, 0x40, 0x64, 0x7f, 0x80, 0xff
+	};
+
+	constexpr std::array<u64, 10> interesting_16 = {
+		0x0000, 0x0080, 0x00ff, 0x0100, 0x0200, 0x03e8, 0x0400, 0x1000, 0x7fff, 0xffff
+	};
+
+	constexpr std::array<u64, 9> interesting_32 = {
+		0x00000000, 0x00008000, 0x0000ffff, 0x00010000, 0x05ffff05,
+		0x7fffffff, 0x80000000, 0xfffffffe, 0xffffffff
+	};
+
+	constexpr std::array<u64, 4> integer_widths = { 1, 2, 4, 8 };
+
+	// write the lowest bytes of the value into the patch
+	static void write_integer(const std::span<u8> bytes, const u64 value, const bool big_endian)
+	{
+		for (u64 i = 0; i < bytes.size(); ++i)
+		{
+			const u64 shift = (big_endian ? bytes.size() - 1 - i : i) * 8;
+			bytes[i] = value >> shift;
+		}
+	}
+
+	static u64 read_integer(const std::span<const u8> bytes, const bool big_endian)
+	{
+		u64 value{0};
+
+		for (u64 i = 0; i < bytes.size(); ++i)
+		{
+			const u64 shift = (big_endian ? bytes.size() - 1 - i : i) * 8;
+			value |= static_cast<u64>(bytes[i]) << shift;
+		}
+
+		return value;
+	}
+
+	mutator::mutator(const std::span<const u8> orig_bytes, const u64 max_bytes_to_change, const mutation_weights& weights, const std::vector<field>& layout, const hotness_map* hotness)
+	:orig_bytes(orig_bytes),
+	 max_bytes_to_change(std::max<u64>(max_bytes_to_change, 1)),
+	 hotness(hotness)
+	{
+		for (const field& f : layout)
+			if (!f.is_checksum() && f.width <= this->max_bytes_to_change)
+				fields.push_back(f);
+
+		u64 total{0};
+		for (u64 i = 0; i < mutation_count; ++i)
+		{
+			// without any fields the field mutation would
+			// just be another interesting mutation
+			if (i != mutation::layout_field || !fields.empty())
+				total += weights[i];
+
+			cumulative_weights[i] = total;
+		}
+
+		assert(total > 0);
+	}
+
+	void mutator::mutate(patch& p, rng& r, const section& s) const
+	{
+		switch (pick_mutation(r))
+		{
+			case mutation::random_bytes:
+				mutate_random_bytes(p, r, s);
+				break;
+
+			case mutation::bit_flip:
+				mutate_bit_flip(p, r, s);
+				break;
+
+			case mutation::arithmetic:
+				mutate_arithmetic(p, r, s);
+				break;
+
+			case mutation::interesting:
+				mutate_interesting(p, r, s);
+				break;
+
+			case mutation::block_copy:
+				mutate_block_copy(p, r, s);
+				break;
+
+			case mutation::block_shift:
+				mutate_block_shift(p, r, s);
+				break;
+
+			case mutation::splice:
+				mutate_splice(p, r, s);
+				break;
+
+			case mutation::layout_field:
+				mutate_field(p, r, s);
+				break;
+
+			case mutation::mutation_count:
+				assert(0);
+				break;
+		}
+	}
+
+	void mutator::mutate_from(const patch& parent, patch& p, rng& r, const section& s) const
+	{
+		assert(!parent.bytes.empty());
+		assert(parent.address >= s.address && parent.end_address() <= s.end_address());
+
+		// half of the time the parent itself gets mutated further,
+		// otherwise the mutation can go anywhere in the section
+		const section target = r.one_in(2) ? section{ parent.address, parent.bytes.size() } : s;
+		mutate(p, r, target);
+
+		const u64 start = std::min(parent.address, p.address);
+		const u64 end = std::max(parent.end_address(), p.end_address());
+
+		std::vector<u8> bytes(orig_bytes.begin() + start, orig_bytes.begin() + end);
+		std::copy(parent.bytes.begin(), parent.bytes.end(), bytes.begin() + (parent.address - start));
+
+		for (u64 i = 0; i < p.bytes.size(); ++i)
+			if (p.bytes[i] != orig_bytes[p.address + i])
+				bytes[p.address - start + i] = p.bytes[i];
+
+		p.address = start;
+		p.bytes = std::move(bytes);
+	}
+
+	void mutator::add_to_corpus(const patch& p)
+	{
+		std::unique_lock lock(corpus_mutex);
+
+		if (corpus.size() < max_corpus_size)
+			corpus.push_back(p);
+		else
+			corpus[next_corpus_index] = p;
+
+		next_corpus_index = (next_corpus_index + 1) % max_corpus_size;
+	}
+
+	u64 mutator::max_bytes(const section& s) const noexcept
+	{
+		return std::min(max_bytes_to_change, s.size);
+	}
+
+	u64 mutator::pick_size(rng& r, const section& s) const
+	{
+		return hotness ? hotness->pick_size(r, max_bytes(s)) : r.below(max_bytes(s)) + 1;
+	}
+
+	mutation mutator::pick_mutation(rng& r) const
+	{
+		const u64 value = r.below(cumulative_weights.back());
+		const auto it = std::upper_bound(cumulative_weights.begin(), cumulative_weights.end(), value);
+		return static_cast<mutation>(it - cumulative_weights.begin());
+	}
+
+	void mutator::pick_range(patch& p, rng& r, const section& s, const u64 size) const
+	{
+		assert(size > 0 && size <= s.size);
+		assert(s.end_address() <= orig_bytes.size());
+
+		p.address = hotness ? hotness->pick_start(r, s, size) : s.address + r.below(s.size - size + 1);
+		p.bytes.assign(orig_bytes.begin() + p.address, orig_bytes.begin() + p.address + size);
+	}
+
+	void mutator::mutate_random_bytes(patch& p, rng& r, const section& s) const
+	{
+		pick_range(p, r, s, pick_size(r, s));
+		r.fill(p.bytes);
+	}
+
+	void mutator::mutate_bit_flip(patch& p, rng& r, const section& s) const
+	{
+		pick_range(p, r, s, pick_size(r, s));
+
+		// flip up to 8 bits, there's no telling which ones are
+		// important so they are picked one by one
+		const u64 bit_count = r.below(std::min<u64>(8, p.bytes.size() * 8)) + 1;
+		for (u64 i = 0; i < bit_count; ++i)
+		{
+			const u64 bit = r.below(p.bytes.size() * 8);
+			p.bytes[bit / 8] ^= 1 << (bit % 8);
+		}
+	}
+
+	void mutator::mutate_arithmetic(patch& p, rng& r, const section& s) const
+	{
+		// pick an integer width that fits in the patch
+		u64 width_count = 1;
+		while (width_count < integer_widths.size() && integer_widths[width_count] <= max_bytes(s))
+			++width_count;
+
+		pick_range(p, r, s, integer_widths[r.below(width_count)]);
+
+		const bool big_endian = r.one_in(2);
+		const u64 delta = r.below(max_arithmetic_delta) + 1;
+
+		u64 value = read_integer(p.bytes, big_endian);
+		value = r.one_in(2) ? value + delta : value - delta;
+		write_integer(p.bytes, value, big_endian);
+	}
+
+	void mutator::mutate_interesting(patch& p, rng& r, const section& s) const
+	{
+		// 64-bit values are left out, the same values in 32-bits
+		// already cover most of the edge cases
+		u64 width_count = 1;
+		while (width_count < 3 && integer_widths[width_count] <= max_bytes(s))
+			++width_count;
+
+		const u64 width = integer_widths[r.below(width_count)];
+		pick_range(p, r, s, width);
+
+		// something that looks like a size or an offset in the file
+		// is just as likely to be trouble as the special values
+		u64 value;
+		if (width > 1 && r.one_in(4))
+		{
+			const std::array<u64, 6> length_like = {
+				orig_bytes.size(),
+				orig_bytes.size() + 1,
+				orig_bytes.size() - 1,
+				orig_bytes.size() - p.address,
+				s.size,
+				s.size + 1
+			};
+			value = length_like[r.below(length_like.size())];
+		}
+		else
+		{
+			switch (width)
+			{
+				case 1:
+					value = interesting_8[r.below(interesting_8.size())];
+					break;
+
+				case 2:
+					value = interesting_16[r.below(interesting_16.size())];
+					break;
+
+				default:
+					value = interesting_32[r.below(interesting_32.size())];
+					break;
+			}
+		}
+
+		write_integer(p.bytes, value, r.one_in(2));
+	}
+
+	void mutator::mutate_block_copy(patch& p, rng& r, const section& s) const
+	{
+		pick_range(p, r, s, pick_size(r, s));
+
+		// the block can come from anywhere in the file, not just the section
+		const u64 source = r.below(orig_bytes.size() - p.bytes.size() + 1);
+		std::copy_n(orig_bytes.begin() + source, p.bytes.size(), p.bytes.begin());
+	}
+
+	void mutator::mutate_block_shift(patch& p, rng& r, const section& s) const
+	{
+		pick_range(p, r, s, pick_size(r, s));
+
+		const u64 size = p.bytes.size();
+		const u64 shift = size > 1 ? r.below(size - 1) + 1 : 1;
+
+		if (r.one_in(2))
+		{
+			// deletion, the bytes after the range move in from the right
+			for (u64 i = 0; i < size; ++i)
+			{
+				const u64 source = p.address + i + shift;
+				p.bytes[i] = source < orig_bytes.size() ? orig_bytes[source] : 0;
+			}
+		}
+		else
+		{
+			// insertion of random bytes, the original bytes move to the right
+			std::copy_backward(p.bytes.begin(), p.bytes.end() - std::min(shift, size), p.bytes.end());
+			r.fill(std::span(p.bytes).first(std::min(shift, size)));
+		}
+	}
+
+	void mutator::mutate_splice(patch& p, rng& r, const section& s) const
+	{
+		bool found_other{false};
+
+		{
+			std::shared_lock lock(corpus_mutex);
+
+			// start from a random patch and go through the corpus
+			// until one that is within the section is found
+			const u64 start = corpus.empty() ? 0 : r.below(corpus.size());
+			for (u64 i = 0; i < corpus.size() && !found_other; ++i)
+			{
+				const patch& other = corpus[(start + i) % corpus.size()];
+				if (other.address < s.address || other.end_address() > s.end_address())
+					continue;
+
+				p.address = other.address;
+				p.bytes.assign(other.bytes.begin(), other.bytes.end());
+				found_other = true;
+			}
+		}
+
+		// nothing to splice with in this section yet
+		if (!found_other)
+		{
+			mutate_random_bytes(p, r, s);
+			return;
+		}
+
+		// keep some of the bytes that caused trouble before and
+		// randomize a part of the rest
+		const u64 start = r.below(p.bytes.size());
+		const u64 size = r.below(p.bytes.size() - start) + 1;
+		r.fill(std::span(p.bytes).subspan(start, size));
+	}
+
+	void mutator::mutate_field(patch& p, rng& r, const section& s) const
+	{
+		// pick one of the fields within the section, all of them
+		// have the same chance of getting picked
+		const field* target{nullptr};
+		u64 field_count{0};
+		for (const field& f : fields)
+			if (f.address >= s.address && f.end_address() <= s.end_address() && r.below(++field_count) == 0)
+				target = &f;
+
+		if (!target)
+		{
+			mutate_interesting(p, r, s);
+			return;
+		}
+
+		const field& f = *target;
+		p.address = f.address;
+		p.bytes.assign(orig_bytes.begin() + f.address, orig_bytes.begin() + f.end_address());
+
+		const u64 value = read_integer(p.bytes, f.big_endian);
+		const u64 max = f.max_value();
+
+		if (f.type == field_type::integer)
+		{
+			const u64 delta = r.below(max_arithmetic_delta) + 1;
+			const u64 interesting_value = f.width == 1 ? interesting_8[r.below(interesting_8.size())]
+				: f.width == 2 ? interesting_16[r.below(interesting_16.size())]
+				: interesting_32[r.below(interesting_32.size())];
+
+			write_integer(p.bytes, r.one_in(2) ? interesting_value : (r.one_in(2) ? value + delta : value - delta), f.big_endian);
+			return;
+		}
+
+		// sizes, counts and offsets that are off by one, far too big or
+		// point outside of the file are where parsers tend to go wrong
+		const u64 bytes_after_field = orig_bytes.size() - f.end_address();
+		const std::array<u64, 16> boundaries = {
+			0, 1, max, max - 1, max >> 1, (max >> 1) + 1,
+			value + 1, value - 1, value * 2, value / 2,
+			orig_bytes.size(), orig_bytes.size() + 1, bytes_after_field, bytes_after_field + 1,
+
+			// an offset that points back to the field itself or to the start
+			// of the file can make the parser go around in circles, and a
+			// count that doesn't fit into 16 bits makes loops run for long
+			f.type == field_type::offset ? f.address : 0x10000,
+			f.type == field_type::offset ? f.address - std::min<u64>(f.address, r.below(max_arithmetic_delta) + 1) : 0x100
+		};
+
+		write_integer(p.bytes, boundaries[r.below(boundaries.size())], f.big_endian);
+	}
+}
@@ -0,0 +1,234 @@
+#include "fingerprint_set.hpp"
+#include "io.hpp"
+#include "output_dir.hpp"
+
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+
+namespace fuzz
+{
+	constexpr char checkpoint_filename[] = "checkpoint";
+	constexpr char tried_filename[] = "tried";
+	constexpr char findings_dirname[] = "findings";
+	constexpr char stats_filename[] = "fuzzer_stats.json";
+	constexpr char slowdown_curve_filename[] = "slowdown_curve.tsv";
+	constexpr char heatmap_filename[] = "heatmap.tsv";
+
+	// bump this if the format of the checkpoint changes
+	constexpr u64 checkpoint_version = 2;
+
+	// short name for the kind of the result, used in the finding filenames
+	//
+	// a command that got killed in the mem mode can still have been
+	// classified as resource exhaustion, which takes precedence
+	static std::string result_kind(const cmd_res& res, const anomaly kind)
+	{
+		if (kind == anomaly::resource_exhaustion)
+			return "mem";
+
+		if (res.timed_out)
+			return "hang";
+
+		if (res.signal != 0)
+			return std::format("sig{}", res.signal);
+
+		if (res.return_value != 0)
+			return std::format("ret{}", res.return_value);
+
+		// nothing wrong with the exit status, so the run was either
+		// slow or used a lot of resources
+		return "slow";
+	}
+
+	// write the file next to its final location first and then move it
+	// over the old file, renaming is atomic within a filesystem
+	static void replace_file(const std::filesystem::path& path, const std::string& contents)
+	{
+		const std::filesystem::path tmp_path = path.string() + ".tmp";
+
+		{
+			std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+			file.write(contents.data(), contents.size());
+
+			if (!file.good())
+				fatal_error(std::format("could not write to '{}'", tmp_path.string()));
+		}
+
+		std::filesystem::rename(tmp_path, path);
+	}
+
+	static std::string samples_str(const std::vector<u64>& samples)
+	{
+		std::string str;
+
+		for (const u64 sample : samples)
+			str += std::format(" {}", sample);
+
+		return str;
+	}
+
+	output_dir::output_dir(const std::filesystem::path& path)
+	:path(path), findings_path(path / findings_dirname)
+	{
+		std::error_code error;
+		std::filesystem::create_directories(findings_path, error);
+
+		if (error)
+			fatal_error(std::format("could not create the output directory '{}': {}", path.string(), error.message()));
+
+		// findings from earlier runs count towards the total
+		for ([[maybe_unused]] const auto& entry : std::filesystem::directory_iterator(findings_path))
+			++findings;
+	}
+
+	bool output_dir::save_finding(const patch& p, const cmd_res& res, const anomaly kind, const verification& v)
+	{
+		const std::string result = result_kind(res, kind);
+		const u64 hash = fingerprint(fingerprint(p), { reinterpret_cast<const u8*>(result.data()), result.size() });
+		const std::filesystem::path finding_path = findings_path / std::format("{}-{:016x}", result, hash);
+
+		std::lock_guard<std::mutex> lock(findings_mutex);
+
+		if (std::filesystem::exists(finding_path))
+			return false;
+
+		// the record is plain text so that it can be read and
+		// applied to the file without any special tools
+		std::string record = std::format("address 0x{:x}\nbytes", p.address);
+		for (const u8 byte : p.bytes)
+			record += std::format(" {:02x}", byte);
+
+		record += std::format("\nresult {}\nexec_time_ns {}\nmax_rss_kb {}\ncpu_time_ns {}\n",
+			result, res.exec_time, res.max_rss_kb, res.cpu_time());
+
+		if (v.runs != 0)
+			record += std::format("anomaly {}\nverified {}/{}\n", anomaly_names.at(static_cast<u64>(kind)), v.reproductions, v.runs);
+
+		// the page fault counter works even if the hardware counters don't
+		if (res.page_faults != 0)
+		{
+			record += std::format("instructions {}\nbranches {}\npage_faults {}\n",
+				res.instructions, res.branches, res.page_faults);
+		}
+
+		replace_file(finding_path, record);
+		++findings;
+
+		return true;
+	}
+
+	void output_dir::save_checkpoint(const checkpoint& c, const std::span<const u64> tried_fingerprints) const
+	{
+		replace_file(path / tried_filename, std::string(reinterpret_cast<const char*>(tried_fingerprints.data()), tried_fingerprints.size_bytes()));
+
+		const std::string contents = std::format(
+			"version {}\n"
+			"file_fingerprint {}\n"
+			"sections_fingerprint {}\n"
+			"seed {}\n"
+			"execution_count {}\n"
+			"exec_time_samples{}\n"
+			"max_rss_kb_samples{}\n"
+			"cpu_time_samples{}\n"
+			"instruction_samples{}\n"
+			"section_executions{}\n"
+			"section_anomalies{}\n",
+			checkpoint_version,
+			c.file_fingerprint,
+			c.sections_fingerprint,
+			c.seed,
+			c.execution_count,
+			samples_str(c.exec_time_samples),
+			samples_str(c.max_rss_kb_samples),
+			samples_str(c.cpu_time_samples),
+			samples_str(c.instruction_samples),
+			samples_str(c.section_executions),
+			samples_str(c.section_anomalies));
+
+		replace_file(path / checkpoint_filename, contents);
+	}
+
+	std::optional<checkpoint> output_dir::load_checkpoint() const
+	{
+		std::ifstream file(path / checkpoint_filename);
+		if (!file.is_open())
+			return std::nullopt;
+
+		checkpoint c{};
+		u64 version{0};
+
+		std::string line;
+		while (std::getline(file, line))
+		{
+			std::stringstream stream(line);
+			std::string key;
+			stream >> key;
+
+			if (key == "version")
+				stream >> version;
+			else if (key == "file_fingerprint")
+				stream >> c.file_fingerprint;
+			else if (key == "sections_fingerprint")
+				stream >> c.sections_fingerprint;
+			else if (key == "seed")
+				stream >> c.seed;
+			else if (key == "execution_count")
+				stream >> c.execution_count;
+			else if (key == "exec_time_samples")
+				c.exec_time_samples.assign(std::istream_iterator<u64>(stream), {});
+			else if (key == "max_rss_kb_samples")
+				c.max_rss_kb_samples.assign(std::istream_iterator<u64>(stream), {});
+			else if (key == "cpu_time_samples")
+				c.cpu_time_samples.assign(std::istream_iterator<u64>(stream), {});
+			else if (key == "instruction_samples")
+				c.instruction_samples.assign(std::istream_iterator<u64>(stream), {});
+			else if (key == "section_executions")
+				c.section_executions.assign(std::istream_iterator<u64>(stream), {});
+			else if (key == "section_anomalies")
+				c.section_anomalies.assign(std::istream_iterator<u64>(stream), {});
+		}
+
+		if (version != checkpoint_version)
+			fatal_error(std::format("the checkpoint in '{}' has an unsupported version {}", path.string(), version));
+
+		return c;
+	}
+
+	std::vector<u64> output_dir::load_tried_fingerprints() const
+	{
+		const std::filesystem::path tried_path = path / tried_filename;
+		if (!std::filesystem::exists(tried_path) || std::filesystem::is_empty(tried_path))
+			return {};
+
+		const std::vector<u8> bytes = read_bytes(tried_path);
+
+		std::vector<u64> fingerprints(bytes.size() / sizeof(u64));
+		std::memcpy(fingerprints.data(), bytes.data(), fingerprints.size() * sizeof(u64));
+
+		return fingerprints;
+	}
+
+	void output_dir::save_stats(const std::string& json) const
+	{
+		replace_file(path / stats_filename, json);
+	}
+
+	void output_dir::save_slowdown_curve(const std::string& tsv) const
+	{
+		replace_file(path / slowdown_curve_filename, tsv);
+	}
+
+	void output_dir::save_heatmap(const std::string& tsv) const
+	{
+		replace_file(path / heatmap_filename, tsv);
+	}
+
+	u64 output_dir::finding_count() const noexcept
+	{
+		return findings;
+	}
+}
@@ -0,0 +1,99 @@
+#include "io.hpp"
+#include "patched_file.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <format>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace fuzz
+{
+	patched_file::patched_file(const std::string& file_path, const std::vector<u8>& orig_bytes, const input_mode mode)
+	:orig_bytes(orig_bytes), file_path(file_path)
+	{
+		assert(!orig_bytes.empty() && "the patched file ended up being empty");
+
+		switch (mode)
+		{
+			case input_mode::file:
+				fd = open(file_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+				break;
+
+			case input_mode::memfd:
+			case input_mode::stdin:
+				// the memfd isn't inherited by the command, it opens the file
+				// through the proc filesystem of the fuzzer instead
+				fd = memfd_create(std::filesystem::path(file_path).filename().c_str(), MFD_CLOEXEC);
+				this->file_path = std::format("/proc/{}/fd/{}", getpid(), fd);
+				break;
+		}
+
+		if (fd == -1)
+			fatal_error(std::format("could not create the patched file '{}': {}", file_path, std::strerror(errno)));
+
+		if (ftruncate(fd, orig_bytes.size()) == -1)
+			fatal_error(std::format("could not resize the patched file '{}': {}", file_path, std::strerror(errno)));
+
+		void* const mapping = mmap(nullptr, orig_bytes.size(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (mapping == MAP_FAILED)
+			fatal_error(std::format("could not map the patched file '{}': {}", file_path, std::strerror(errno)));
+
+		data = static_cast<u8*>(mapping);
+		std::copy(orig_bytes.begin(), orig_bytes.end(), data);
+	}
+
+	patched_file::~patched_file()
+	{
+		munmap(data, orig_bytes.size());
+		close(fd);
+	}
+
+	void patched_file::apply(const patch& p)
+	{
+		assert(p.end_address() <= orig_bytes.size());
+
+		std::copy(orig_bytes.begin() + prev_address, orig_bytes.begin() + prev_address + prev_size, data + prev_address);
+		std::copy(p.bytes.begin(), p.bytes.end(), data + p.address);
+
+		prev_address = p.address;
+		prev_size = p.bytes.size();
+	}
+
+	void patched_file::fix_checksums(const std::span<const field> checksums)
+	{
+		for (const field& f : checksums)
+		{
+			// the checksum only changes if the patch touches the range it covers
+			const u64 prev_end = prev_address + prev_size;
+			if (prev_size == 0 || prev_address >= f.checksum_address + f.checksum_size || prev_end <= f.checksum_address)
+				continue;
+
+			write_field(f, { data, orig_bytes.size() }, calculate_checksum(f, bytes()));
+
+			// a checksum that covers an earlier one sees the fixed value
+			// of it, since the fields are fixed in the order they were given
+			prev_address = std::min(prev_address, f.address);
+			prev_size = std::max(prev_end, f.end_address()) - prev_address;
+		}
+	}
+
+	const std::string& patched_file::path() const noexcept
+	{
+		return file_path;
+	}
+
+	std::span<const u8> patched_file::bytes() const noexcept
+	{
+		return { data, orig_bytes.size() };
+	}
+
+	i32 patched_file::file_descriptor() const noexcept
+	{
+		return fd;
+	}
+}
@@ -0,0 +1,71 @@
+#include "perf_counters.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace fuzz
+{
+	static i32 open_counter(const u32 type, const u64 config)
+	{
+		perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = type;
+		attr.config = config;
+
+		// follow the commands that get started after this and count them too
+		attr.inherit = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+
+		// the calling thread on any cpu
+		return syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+	}
+
+	static u64 read_counter(const i32 fd)
+	{
+		if (fd == -1)
+			return 0;
+
+		u64 value{0};
+		if (::read(fd, &value, sizeof(value)) != sizeof(value))
+			return 0;
+
+		return value;
+	}
+
+	perf_counters::perf_counters()
+	:instructions_fd(open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS)),
+	 branches_fd(open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS)),
+	 page_faults_fd(open_counter(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS))
+	{}
+
+	perf_counters::~perf_counters()
+	{
+		for (const i32 fd : { instructions_fd, branches_fd, page_faults_fd })
+			if (fd != -1)
+				close(fd);
+	}
+
+	perf_counters::values perf_counters::read() const
+	{
+		return {
+			read_counter(instructions_fd),
+			read_counter(branches_fd),
+			read_counter(page_faults_fd)
+		};
+	}
+
+	std::string perf_counters::instructions_unavailable_reason()
+	{
+		const i32 fd = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+		if (fd == -1)
+			return strerror(errno);
+
+		close(fd);
+		return "";
+	}
+}
@@ -0,0 +1,108 @@
+#include "io.hpp"
+#include "reporter.hpp"
+
+#include <iostream>
+
+namespace fuzz
+{
+	reporter::reporter(const bool print_usage)
+	:print_usage(print_usage), thread(&reporter::work, this)
+	{}
+
+	reporter::~reporter()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		queue_cv.notify_one();
+		thread.join();
+	}
+
+	void reporter::report(const patch& p, const cmd_res res, const std::string& note)
+	{
+		push([this, p, res, note]
+		{
+			// clear the spinner from the current line
+			clear_cli_line();
+			print_result(p, res, print_usage, note);
+		});
+	}
+
+	void reporter::message(const std::string& msg)
+	{
+		push([msg]
+		{
+			clear_cli_line();
+			std::cout << msg << std::flush;
+		});
+	}
+
+	void reporter::print_spinner(const std::string& status)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			spinner_status = status;
+
+			if (spinner_queued)
+				return;
+
+			spinner_queued = true;
+			queue.push_back([this]
+			{
+				std::string status;
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					status = spinner_status;
+					spinner_queued = false;
+				}
+
+				fuzz::print_spinner();
+				std::cout << status << std::flush;
+			});
+		}
+		queue_cv.notify_one();
+	}
+
+	void reporter::flush()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		empty_cv.wait(lock, [this] { return queue.empty() && !printing; });
+	}
+
+	void reporter::push(std::function<void()> printer)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			queue.push_back(std::move(printer));
+			spinner_queued = false;
+		}
+		queue_cv.notify_one();
+	}
+
+	void reporter::work()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+
+		while (true)
+		{
+			queue_cv.wait(lock, [this] { return stopping || !queue.empty(); });
+
+			// print everything that is left before stopping
+			if (queue.empty() && stopping)
+				return;
+
+			std::function<void()> printer = std::move(queue.front());
+			queue.pop_front();
+			printing = true;
+
+			lock.unlock();
+			printer();
+			lock.lock();
+
+			printing = false;
+			if (queue.empty())
+				empty_cv.notify_all();
+		}
+	}
+}
@@ -0,0 +1,77 @@
+#include "resource_model.hpp"
+
+#include <algorithm>
+#include <sys/resource.h>
+
+namespace fuzz
+{
+	// the cpu time is accounted in scheduler ticks on many kernels, so commands
+	// that run for a shorter time than this can't be compared reliably
+	constexpr u64 min_cpu_time_ns = 10'000'000;
+
+	// the peak memory usage of a child includes the peak memory usage of the
+	// process that it was started from, since exec records the peak of the
+	// address space it replaces and vfork starts the child with the address
+	// space of the fuzzer
+	//
+	// a command started straight from the fuzzer can't be told to use more
+	// memory than normal unless it goes over the peak memory usage of the
+	// fuzzer itself
+	static u64 own_max_rss_kb()
+	{
+		rusage usage{};
+		getrusage(RUSAGE_SELF, &usage);
+		return usage.ru_maxrss;
+	}
+
+	resource_model::resource_model(const f32 usage_ratio, const bool started_from_fuzzer)
+	:usage_ratio(usage_ratio),
+	 started_from_fuzzer(started_from_fuzzer)
+	{}
+
+	void resource_model::add_sample(const cmd_res& res)
+	{
+		add_sample(res.max_rss_kb, res.cpu_time());
+	}
+
+	void resource_model::add_sample(const u64 max_rss_kb_sample, const u64 cpu_time_ns)
+	{
+		max_rss_kb.add(max_rss_kb_sample);
+		cpu_time.add(cpu_time_ns);
+	}
+
+	u64 resource_model::median_max_rss_kb() const noexcept
+	{
+		return max_rss_kb.median();
+	}
+
+	u64 resource_model::median_cpu_time() const noexcept
+	{
+		return cpu_time.median();
+	}
+
+	std::vector<u64> resource_model::max_rss_kb_snapshot() const
+	{
+		return max_rss_kb.snapshot();
+	}
+
+	std::vector<u64> resource_model::cpu_time_snapshot() const
+	{
+		return cpu_time.snapshot();
+	}
+
+	u64 resource_model::cpu_time_threshold() const noexcept
+	{
+		return std::max(median_cpu_time(), min_cpu_time_ns) * usage_ratio;
+	}
+
+	bool resource_model::is_excessive(const cmd_res& res) const noexcept
+	{
+		const u64 max_rss_kb_baseline = started_from_fuzzer
+			? std::max(median_max_rss_kb(), own_max_rss_kb())
+			: median_max_rss_kb();
+
+		return res.max_rss_kb > max_rss_kb_baseline * usage_ratio
+			|| res.cpu_time() > cpu_time_threshold();
+	}
+}
@@ -0,0 +1,85 @@
+#include "sample_window.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace fuzz
+{
+	// how many of the most recent samples are kept
+	constexpr u64 sample_window_size = 1024;
+
+	// once the window is full, recalculating the stats after every
+	// sample would be a waste of time
+	constexpr u64 samples_per_update = 32;
+
+	sample_window::sample_window()
+	{
+		samples.reserve(sample_window_size);
+	}
+
+	void sample_window::add(const u64 sample)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if (samples.size() < sample_window_size)
+		{
+			samples.push_back(sample);
+
+			// the stats are updated right away while there are only a
+			// few samples, e.g. right after the dry runs
+			update_stats();
+			return;
+		}
+
+		samples[next_sample] = sample;
+		next_sample = (next_sample + 1) % sample_window_size;
+
+		if (++samples_since_update >= samples_per_update)
+			update_stats();
+	}
+
+	u64 sample_window::median() const noexcept
+	{
+		return median_value;
+	}
+
+	u64 sample_window::p99() const noexcept
+	{
+		return p99_value;
+	}
+
+	u64 sample_window::mad() const noexcept
+	{
+		return mad_value;
+	}
+
+	std::vector<u64> sample_window::snapshot() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return samples;
+	}
+
+	void sample_window::update_stats()
+	{
+		samples_since_update = 0;
+
+		std::vector<u64> sorted = samples;
+
+		const u64 median_index = sorted.size() / 2;
+		std::nth_element(sorted.begin(), sorted.begin() + median_index, sorted.end());
+		const u64 median = sorted[median_index];
+
+		const u64 p99_index = std::min<u64>(std::ceil(sorted.size() * 0.99), sorted.size() - 1);
+		std::nth_element(sorted.begin(), sorted.begin() + p99_index, sorted.end());
+		const u64 p99 = sorted[p99_index];
+
+		for (u64& sample : sorted)
+			sample = sample > median ? sample - median : median - sample;
+
+		std::nth_element(sorted.begin(), sorted.begin() + median_index, sorted.end());
+
+		median_value = median;
+		p99_value = p99;
+		mad_value = sorted[median_index];
+	}
+}
@@ -0,0 +1,80 @@
+#include "section_scheduler.hpp"
+
+#include <cassert>
+
+namespace fuzz
+{
+	// part of the executions are spread evenly across all of the sections so
+	// that a section that hasn't produced anything yet isn't forgotten about
+	constexpr f64 exploration_ratio = 0.1;
+
+	// the yield of a section is estimated as if it had this many executions
+	// without anomalies on top of the real ones, so that a lucky first hit
+	// doesn't take over all of the executions
+	constexpr f64 prior_executions = 32.0;
+
+	section_scheduler::section_scheduler(const std::vector<section>& sections)
+	:section_list(sections), executions(sections.size()), anomalies(sections.size())
+	{
+		assert(!section_list.empty());
+	}
+
+	u64 section_scheduler::pick(rng& r) const
+	{
+		if (section_list.size() == 1)
+			return 0;
+
+		// anomalies per execution with one made up anomaly, so
+		// that every section always has some weight
+		std::vector<f64> yields(section_list.size());
+		f64 total_yield{0};
+		for (u64 i = 0; i < section_list.size(); ++i)
+		{
+			yields[i] = (anomaly_count(i) + 1.0) / (execution_count(i) + prior_executions);
+			total_yield += yields[i];
+		}
+
+		// 53 bits is the precision of a double
+		const f64 value = (r() >> 11) * 0x1.0p-53;
+
+		f64 cumulative{0};
+		for (u64 i = 0; i < section_list.size(); ++i)
+		{
+			cumulative += exploration_ratio / section_list.size() + (1.0 - exploration_ratio) * yields[i] / total_yield;
+			if (value < cumulative)
+				return i;
+		}
+
+		// rounding errors can leave the sum slightly below one
+		return section_list.size() - 1;
+	}
+
+	void section_scheduler::record(const u64 index, const bool anomaly)
+	{
+		executions[index].fetch_add(1, std::memory_order_relaxed);
+
+		if (anomaly)
+			anomalies[index].fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void section_scheduler::restore(const u64 index, const u64 execution_count, const u64 anomaly_count)
+	{
+		executions[index] = execution_count;
+		anomalies[index] = anomaly_count;
+	}
+
+	const std::vector<section>& section_scheduler::sections() const noexcept
+	{
+		return section_list;
+	}
+
+	u64 section_scheduler::execution_count(const u64 index) const noexcept
+	{
+		return executions[index].load(std::memory_order_relaxed);
+	}
+
+	u64 section_scheduler::anomaly_count(const u64 index) const noexcept
+	{
+		return anomalies[index].load(std::memory_order_relaxed);
+	}
+}
@@ -0,0 +1,69 @@
+#include "fingerprint_set.hpp"
+#include "slowdown_population.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace fuzz
+{
+	slowdown_population::slowdown_population(const u64 capacity)
+	:capacity(capacity)
+	{
+		assert(capacity > 0);
+	}
+
+	u64 slowdown_population::admission_cost() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return entries.size() < capacity ? 0 : entries.back().cost;
+	}
+
+	bool slowdown_population::offer(const slow_patch& s)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if (entries.size() == capacity && s.cost <= entries.back().cost)
+			return false;
+
+		// the same patch can get offered again if it was run more than
+		// once, it only needs to be in the population once
+		const u64 fp = fingerprint(s.p);
+		const auto existing = std::find_if(entries.begin(), entries.end(), [fp](const slow_patch& e) { return fingerprint(e.p) == fp; });
+		if (existing != entries.end())
+		{
+			if (s.cost <= existing->cost)
+				return false;
+
+			entries.erase(existing);
+		}
+
+		const auto position = std::upper_bound(entries.begin(), entries.end(), s.cost, [](const u64 cost, const slow_patch& e) { return cost > e.cost; });
+		entries.insert(position, s);
+
+		if (entries.size() > capacity)
+			entries.pop_back();
+
+		return true;
+	}
+
+	std::optional<slow_patch> slowdown_population::pick(rng& r) const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if (entries.empty())
+			return std::nullopt;
+
+		// tournament of two, the entries are sorted so the
+		// smaller index is the slower patch
+		const u64 a = r.below(entries.size());
+		const u64 b = r.below(entries.size());
+
+		return entries[std::min(a, b)];
+	}
+
+	std::vector<slow_patch> slowdown_population::snapshot() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return entries;
+	}
+}
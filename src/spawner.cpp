@@ -0,0 +1,419 @@
+#include "coverage_protocol.hpp"
+#include "io.hpp"
+#include "spawner.hpp"
+#include "timer.hpp"
+
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <format>
+#include <spawn.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+extern char** environ;
+
+namespace fuzz
+{
+	// file descriptor of the socket between the fuzzer and the spawner,
+	// right below the shared memory of the coverage runtime
+	constexpr i32 spawner_fd = 196;
+
+	// environment variable that tells the fuzzer to run as a spawner
+	constexpr char spawner_env[] = "DOS_FUZZER_SPAWNER";
+
+	// argv[0] of the spawner, the arguments of the command come after it
+	constexpr char spawner_name[] = "dos-fuzzer-spawner";
+
+	// the spawner writes this when it is ready
+	constexpr u32 spawner_hello = 0x444f5353;
+
+	// the spawner writes this once a command has exited, and the fuzzer
+	// replies with the reap request when it's done signalling the process
+	// group of the command
+	constexpr u32 command_exited = 2;
+	constexpr u32 reap_request = 3;
+
+	// the spawner should be up and running way before this
+	constexpr u64 spawner_startup_time_limit_ms = 10'000;
+
+	// both ends of the socket are the same binary, so the messages are plain structs
+	//
+	// for each run: the fuzzer sends a run request with the read end of the
+	// stdin pipe attached to it, the spawner replies with the pid of the
+	// command once it has been started and with an exit message once it has
+	// exited. after the reap request, the spawner reaps the command and sends
+	// its wait status and resource usage
+	//
+	// the command is only reaped after the reap request so that its pid
+	// can't be reused while the fuzzer might still signal it
+	struct run_request
+	{
+		u64 cpu_limit_s;
+		u64 memory_limit_mb;
+	};
+
+	struct spawn_result
+	{
+		pid_t pid;
+
+		// errno of the exec if it failed, nothing else is sent for the run then
+		i32 exec_error;
+	};
+
+	struct exit_result
+	{
+		i32 status;
+		rusage usage;
+	};
+
+	// if stdin_fd isn't -1, it gets sent along with the request
+	static bool send_request(const i32 socket_fd, const run_request& request, const i32 stdin_fd)
+	{
+		iovec iov{ const_cast<run_request*>(&request), sizeof(request) };
+
+		msghdr msg{};
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+
+		alignas(cmsghdr) char control[CMSG_SPACE(sizeof(i32))]{};
+		if (stdin_fd != -1)
+		{
+			msg.msg_control = control;
+			msg.msg_controllen = sizeof(control);
+
+			cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+			cmsg->cmsg_level = SOL_SOCKET;
+			cmsg->cmsg_type = SCM_RIGHTS;
+			cmsg->cmsg_len = CMSG_LEN(sizeof(i32));
+			std::memcpy(CMSG_DATA(cmsg), &stdin_fd, sizeof(i32));
+		}
+
+		while (true)
+		{
+			const ssize_t res = sendmsg(socket_fd, &msg, MSG_NOSIGNAL);
+			if (res == sizeof(request))
+				return true;
+
+			if (res == -1 && errno == EINTR)
+				continue;
+
+			return false;
+		}
+	}
+
+	// returns false once the fuzzer has closed the socket
+	static bool receive_request(run_request& request, i32& stdin_fd)
+	{
+		iovec iov{ &request, sizeof(request) };
+
+		msghdr msg{};
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+
+		alignas(cmsghdr) char control[CMSG_SPACE(sizeof(i32))]{};
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+
+		ssize_t res;
+		do
+			res = recvmsg(spawner_fd, &msg, MSG_CMSG_CLOEXEC);
+		while (res == -1 && errno == EINTR);
+
+		if (res != sizeof(request))
+			return false;
+
+		stdin_fd = -1;
+		const cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+		if (cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+			std::memcpy(&stdin_fd, CMSG_DATA(cmsg), sizeof(i32));
+
+		return true;
+	}
+
+	// the fuzzer is gone if this fails, so there's nothing left to do
+	static void send_to_fuzzer(const void* buffer, const u64 size)
+	{
+		if (write(spawner_fd, buffer, size) != static_cast<ssize_t>(size))
+			_exit(1);
+	}
+
+	// the fuzzer is gone if it sent anything else
+	static void receive_reap_request()
+	{
+		u32 message;
+		ssize_t res;
+		do
+			res = read(spawner_fd, &message, sizeof(message));
+		while (res == -1 && errno == EINTR);
+
+		if (res != sizeof(message) || message != reap_request)
+			_exit(1);
+	}
+
+	void serve_as_spawner(char** argv)
+	{
+		if (!std::getenv(spawner_env))
+			return;
+
+		// the commands shouldn't become spawners too, and they
+		// shouldn't get the socket either
+		unsetenv(spawner_env);
+		fcntl(spawner_fd, F_SETFD, FD_CLOEXEC);
+
+		char** const cmd_argv = argv + 1;
+
+		send_to_fuzzer(&spawner_hello, sizeof(spawner_hello));
+
+		run_request request;
+		i32 stdin_fd;
+		while (receive_request(request, stdin_fd))
+		{
+			// a failed exec is reported through a pipe that a successful one closes
+			i32 error_pipe[2];
+			if (pipe2(error_pipe, O_CLOEXEC) == -1)
+				_exit(1);
+
+			const pid_t pid = fork();
+			if (pid == -1)
+				_exit(1);
+
+			// the command gets a process group of its own so that the
+			// fuzzer can kill it and everything it starts
+			if (pid == 0)
+			{
+				setpgid(0, 0);
+				exec_limits limits;
+				limits.cpu_limit_s = request.cpu_limit_s;
+				limits.memory_limit_mb = request.memory_limit_mb;
+				apply_resource_limits(limits);
+
+				if (stdin_fd != -1)
+					dup2(stdin_fd, STDIN_FILENO);
+
+				execvp(cmd_argv[0], cmd_argv);
+
+				const i32 error = errno;
+				[[maybe_unused]] const ssize_t written = write(error_pipe[1], &error, sizeof(error));
+				_exit(127);
+			}
+
+			close(error_pipe[1]);
+			if (stdin_fd != -1)
+				close(stdin_fd);
+
+			spawn_result spawned{ pid, 0 };
+			while (read(error_pipe[0], &spawned.exec_error, sizeof(spawned.exec_error)) == -1 && errno == EINTR);
+			close(error_pipe[0]);
+
+			// the pipe is closed by the exec, so the command has moved into
+			// its own process group by the time the fuzzer gets its pid
+			send_to_fuzzer(&spawned, sizeof(spawned));
+
+			// the command is left as a zombie until the fuzzer is done with it
+			if (spawned.exec_error == 0)
+			{
+				siginfo_t info;
+				while (waitid(P_PID, pid, &info, WEXITED | WNOWAIT) == -1)
+				{
+					if (errno != EINTR)
+						_exit(1);
+				}
+
+				send_to_fuzzer(&command_exited, sizeof(command_exited));
+				receive_reap_request();
+			}
+
+			exit_result exited{};
+			while (wait4(pid, &exited.status, 0, &exited.usage) == -1)
+			{
+				if (errno != EINTR)
+					_exit(1);
+			}
+
+			if (spawned.exec_error == 0)
+				send_to_fuzzer(&exited, sizeof(exited));
+		}
+
+		// the fuzzer has closed the socket
+		_exit(0);
+	}
+
+	spawner::spawner(const command& cmd, const i32 coverage_fd)
+	:program(cmd.argv()[0])
+	{
+		// the socket is close-on-exec so that the other workers' processes
+		// don't keep it open, dup2 clears the flag for the spawner itself
+		i32 sockets[2];
+		if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets) == -1)
+			fatal_error(std::format("could not create the spawner socket: {}", std::strerror(errno)));
+
+		// the socket could be the fd of the coverage runtime or the other way
+		// around, so both of them get copied out of the way first
+		const i32 spawner_socket = dup_above_fixed_fds(sockets[1]);
+		const i32 spawner_coverage_fd = dup_above_fixed_fds(coverage_fd);
+		close(sockets[1]);
+
+		posix_spawn_file_actions_t file_actions;
+		posix_spawn_file_actions_init(&file_actions);
+		posix_spawn_file_actions_adddup2(&file_actions, spawner_socket, spawner_fd);
+
+		if (spawner_coverage_fd != -1)
+			posix_spawn_file_actions_adddup2(&file_actions, spawner_coverage_fd, coverage_protocol::coverage_fd);
+
+		// SIGPIPE is ignored by the fuzzer because of the stdin pipes,
+		// but the commands should get the default behaviour
+		sigset_t default_signals;
+		sigemptyset(&default_signals);
+		sigaddset(&default_signals, SIGPIPE);
+
+		// the spawner gets a process group of its own so that a ctrl-c in the
+		// terminal only reaches the fuzzer, which then stops everything cleanly
+		posix_spawnattr_t attr;
+		posix_spawnattr_init(&attr);
+		posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGDEF);
+		posix_spawnattr_setpgroup(&attr, 0);
+		posix_spawnattr_setsigdefault(&attr, &default_signals);
+
+		std::vector<char*> argv = { const_cast<char*>(spawner_name) };
+		for (char* const* arg = cmd.argv(); *arg; ++arg)
+			argv.push_back(*arg);
+		argv.push_back(nullptr);
+
+		std::vector<std::string> env_strings;
+		for (char** env = environ; *env; ++env)
+			env_strings.push_back(*env);
+		env_strings.push_back(std::format("{}=1", spawner_env));
+
+		std::vector<char*> env_ptrs;
+		for (std::string& env : env_strings)
+			env_ptrs.push_back(env.data());
+		env_ptrs.push_back(nullptr);
+
+		// the spawner is the fuzzer binary itself, so there's nothing extra to install
+		const i32 spawn_err = posix_spawn(&pid, "/proc/self/exe", &file_actions, &attr, argv.data(), env_ptrs.data());
+		posix_spawn_file_actions_destroy(&file_actions);
+		posix_spawnattr_destroy(&attr);
+
+		close(spawner_socket);
+		if (spawner_coverage_fd != -1)
+			close(spawner_coverage_fd);
+
+		if (spawn_err)
+			fatal_error(std::format("could not start the spawner: {}", std::strerror(spawn_err)));
+
+		socket_fd = sockets[0];
+
+		u32 hello{0};
+		if (wait_for_fd(socket_fd, deadline_after(spawner_startup_time_limit_ms * 1'000'000)))
+			read_exact(&hello, sizeof(hello));
+
+		if (hello != spawner_hello)
+			fatal_error("the spawner didn't start");
+	}
+
+	spawner::~spawner()
+	{
+		// closing the socket makes the spawner exit on its own
+		close(socket_fd);
+
+		kill(pid, SIGKILL);
+		waitpid(pid, nullptr, 0);
+	}
+
+	cmd_res spawner::run(const exec_limits& limits, const std::span<const u8> stdin_bytes)
+	{
+		timer t;
+		cmd_res res;
+
+		const timespec deadline = deadline_after(limits.time_limit_ns == no_time_limit ? 0 : limits.time_limit_ns);
+
+		i32 stdin_pipe[2] = { -1, -1 };
+		if (!stdin_bytes.empty())
+		{
+			if (pipe2(stdin_pipe, O_CLOEXEC) == -1)
+				fatal_error(std::format("could not create a stdin pipe: {}", std::strerror(errno)));
+
+			// try to fit the whole input into the pipe at once, this fails
+			// silently if the input is larger than the maximum pipe size
+			fcntl(stdin_pipe[1], F_SETPIPE_SZ, stdin_bytes.size());
+			fcntl(stdin_pipe[1], F_SETFL, O_NONBLOCK);
+		}
+
+		t.start();
+
+		if (!send_request(socket_fd, { limits.cpu_limit_s, limits.memory_limit_mb }, stdin_pipe[0]))
+			fatal_error("could not send a run request to the spawner");
+
+		spawn_result spawned;
+		read_exact(&spawned, sizeof(spawned));
+		res.spawn_time = t.elapsed_nanos();
+
+		if (spawned.exec_error != 0)
+			fatal_error(std::format("could not start '{}': {}", program, std::strerror(spawned.exec_error)));
+
+		// the spawner replies again once the command has exited, so the
+		// socket becomes readable at the same time as a pidfd would
+		if (!stdin_bytes.empty())
+		{
+			close(stdin_pipe[0]);
+			feed_stdin(stdin_pipe[1], socket_fd, stdin_bytes, deadline, limits);
+
+			// closing the pipe lets the command know that there's nothing more to read
+			close(stdin_pipe[1]);
+		}
+
+		// the spawner doesn't reap the command before the reap request,
+		// so the process group can be signalled until then
+		res.timed_out = wait_or_kill(spawned.pid, socket_fd, deadline, limits);
+
+		u32 message;
+		read_exact(&message, sizeof(message));
+		if (message != command_exited)
+			fatal_error("the spawner sent an unexpected message");
+
+		if (write(socket_fd, &reap_request, sizeof(reap_request)) != sizeof(reap_request))
+			fatal_error("could not send a reap request to the spawner");
+
+		exit_result exited;
+		read_exact(&exited, sizeof(exited));
+
+		res.exec_time = t.elapsed_nanos();
+		set_exit_status(res, exited.status);
+
+		res.max_rss_kb = exited.usage.ru_maxrss;
+		res.user_time = exited.usage.ru_utime.tv_sec * 1'000'000'000ul + exited.usage.ru_utime.tv_usec * 1'000ul;
+		res.system_time = exited.usage.ru_stime.tv_sec * 1'000'000'000ul + exited.usage.ru_stime.tv_usec * 1'000ul;
+		res.minor_faults = exited.usage.ru_minflt;
+		res.major_faults = exited.usage.ru_majflt;
+		res.voluntary_switches = exited.usage.ru_nvcsw;
+		res.involuntary_switches = exited.usage.ru_nivcsw;
+
+		return res;
+	}
+
+	void spawner::read_exact(void* buffer, const u64 size)
+	{
+		u64 bytes_read{0};
+
+		while (bytes_read < size)
+		{
+			const ssize_t res = read(socket_fd, static_cast<u8*>(buffer) + bytes_read, size - bytes_read);
+			if (res > 0)
+			{
+				bytes_read += res;
+				continue;
+			}
+
+			if (res == -1 && errno == EINTR)
+				continue;
+
+			fatal_error("the spawner has stopped responding");
+		}
+	}
+}
@@ -0,0 +1,196 @@
+#include "io.hpp"
+#include "stats.hpp"
+
+#include <bit>
+#include <format>
+
+namespace fuzz
+{
+	void histogram::record(const u64 ns) noexcept
+	{
+		buckets[bucket_index(ns)].fetch_add(1, std::memory_order_relaxed);
+		count_value.fetch_add(1, std::memory_order_relaxed);
+		total_value.fetch_add(ns, std::memory_order_relaxed);
+
+		u64 current_max = max_value.load(std::memory_order_relaxed);
+		while (ns > current_max && !max_value.compare_exchange_weak(current_max, ns, std::memory_order_relaxed));
+	}
+
+	u64 histogram::count() const noexcept
+	{
+		return count_value.load(std::memory_order_relaxed);
+	}
+
+	u64 histogram::total() const noexcept
+	{
+		return total_value.load(std::memory_order_relaxed);
+	}
+
+	u64 histogram::max() const noexcept
+	{
+		return max_value.load(std::memory_order_relaxed);
+	}
+
+	u64 histogram::percentile(const f64 p) const noexcept
+	{
+		const u64 target = p * count();
+
+		u64 seen{0};
+		for (u64 i = 0; i < bucket_count; ++i)
+		{
+			seen += buckets[i].load(std::memory_order_relaxed);
+			if (seen > target)
+				return bucket_lower_bound(i);
+		}
+
+		return max();
+	}
+
+	u64 histogram::bucket_index(const u64 ns) noexcept
+	{
+		if (ns < linear_limit)
+			return ns;
+
+		// the highest bit picks the power of two and the bits
+		// right below it pick the linear bucket within it
+		const u64 exponent = std::bit_width(ns) - 1;
+		const u64 sub_bucket = (ns >> (exponent - sub_bucket_bits)) & (sub_bucket_count - 1);
+
+		return linear_limit + (exponent - sub_bucket_bits - 1) * sub_bucket_count + sub_bucket;
+	}
+
+	u64 histogram::bucket_lower_bound(const u64 index) noexcept
+	{
+		if (index < linear_limit)
+			return index;
+
+		const u64 exponent = (index - linear_limit) / sub_bucket_count + sub_bucket_bits + 1;
+		const u64 sub_bucket = (index - linear_limit) % sub_bucket_count;
+
+		return (sub_bucket_count + sub_bucket) << (exponent - sub_bucket_bits);
+	}
+
+	stats::stats()
+	{
+		elapsed.start();
+	}
+
+	void stats::record_execution(const cmd_res& res) noexcept
+	{
+		execution_count.fetch_add(1, std::memory_order_relaxed);
+
+		phases[phase::patch_file].record(res.patch_time);
+		phases[phase::spawn].record(res.spawn_time);
+		phases[phase::target].record(res.exec_time - res.spawn_time);
+	}
+
+	void stats::record_phase(const phase ph, const u64 ns) noexcept
+	{
+		phases[ph].record(ns);
+	}
+
+	void stats::record_anomalies(const bool crash, const bool hang, const bool resource_exhaustion) noexcept
+	{
+		if (crash)
+			crashes.fetch_add(1, std::memory_order_relaxed);
+
+		if (hang)
+			hangs.fetch_add(1, std::memory_order_relaxed);
+
+		if (resource_exhaustion)
+			resource_exhaustions.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void stats::record_minimization(const u64 execution_count) noexcept
+	{
+		minimization_executions.fetch_add(execution_count, std::memory_order_relaxed);
+	}
+
+	void stats::record_executions(const u64 count) noexcept
+	{
+		execution_count.fetch_add(count, std::memory_order_relaxed);
+	}
+
+	void stats::record_finding() noexcept
+	{
+		// the execution count is used as the marker, since the
+		// first finding could be found in less than a millisecond
+		u64 expected{0};
+		if (first_finding_execs.compare_exchange_strong(expected, executions(), std::memory_order_relaxed))
+			first_finding_ms.store(elapsed.elapsed_millis(), std::memory_order_relaxed);
+	}
+
+	void stats::record_unconfirmed() noexcept
+	{
+		unconfirmed_anomalies.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void stats::record_coverage(const u64 edge_count, const u64 seed_count) noexcept
+	{
+		edges.store(edge_count, std::memory_order_relaxed);
+		seeds.store(seed_count, std::memory_order_relaxed);
+	}
+
+	u64 stats::executions() const noexcept
+	{
+		return execution_count.load(std::memory_order_relaxed);
+	}
+
+	f64 stats::execs_per_sec() const noexcept
+	{
+		const u64 elapsed_ms = elapsed.elapsed_millis();
+		return elapsed_ms == 0 ? 0.0 : executions() * 1000.0 / elapsed_ms;
+	}
+
+	std::string stats::status_line() const
+	{
+		std::string line = std::format(" {:.0f} execs/s | {} execs | {} crashes, {} hangs, {} mem",
+			execs_per_sec(), executions(), crashes.load(), hangs.load(), resource_exhaustions.load());
+
+		// a coordinator doesn't run anything itself, so it has no timings
+		if (phases[phase::target].count() != 0)
+		{
+			line += std::format(" | target p50 {} | spawn p50 {}",
+				format_duration(phases[phase::target].percentile(0.5)),
+				format_duration(phases[phase::spawn].percentile(0.5)));
+		}
+
+		// without a coverage runtime in the command there are no edges
+		if (edges.load() != 0)
+			line += std::format(" | {} edges, {} seeds", edges.load(), seeds.load());
+
+		return line;
+	}
+
+	std::string stats::to_json() const
+	{
+		std::string phases_json;
+		for (u64 i = 0; i < phase_count; ++i)
+		{
+			const histogram& h = phases[i];
+			phases_json += std::format("{}\n\t\t\"{}\": {{ \"count\": {}, \"total_ns\": {}, \"p50_ns\": {}, \"p90_ns\": {}, \"p99_ns\": {}, \"max_ns\": {} }}",
+				i == 0 ? "" : ",", phase_names[i], h.count(), h.total(), h.percentile(0.5), h.percentile(0.9), h.percentile(0.99), h.max());
+		}
+
+		return std::format(
+			"{{\n"
+			"\t\"elapsed_ms\": {},\n"
+			"\t\"executions\": {},\n"
+			"\t\"execs_per_sec\": {:.1f},\n"
+			"\t\"crashes\": {},\n"
+			"\t\"hangs\": {},\n"
+			"\t\"resource_exhaustions\": {},\n"
+			"\t\"unconfirmed_anomalies\": {},\n"
+			"\t\"edges\": {},\n"
+			"\t\"seeds\": {},\n"
+			"\t\"first_finding_ms\": {},\n"
+			"\t\"first_finding_execs\": {},\n"
+			"\t\"minimization_executions\": {},\n"
+			"\t\"phases\": {{{}\n"
+			"\t}}\n"
+			"}}\n",
+			elapsed.elapsed_millis(), executions(), execs_per_sec(),
+			crashes.load(), hangs.load(), resource_exhaustions.load(), unconfirmed_anomalies.load(), edges.load(), seeds.load(),
+			first_finding_ms.load(), first_finding_execs.load(), minimization_executions.load(), phases_json);
+	}
+}
@@ -0,0 +1,108 @@
+#include "timer.hpp"
+#include "worker.hpp"
+
+#include <algorithm>
+#include <format>
+#include <iterator>
+
+namespace fuzz
+{
+	static std::string worker_bin_path(const u64 id, const opts& o)
+	{
+		// the first worker uses the same path that was used before
+		// there were multiple workers
+		return id == 0 ? o.patched_bin_path : std::format("{}.{}", o.patched_bin_path, id);
+	}
+
+	bool uses_spawner(const opts& o)
+	{
+		return o.mode == mode::mem && o.forkserver_shim_path.empty();
+	}
+
+	worker::worker(const u64 id, const opts& o, const std::vector<u8>& orig_bytes, const u64 seed)
+	:id(id),
+	 rng(seed + id),
+	 file(worker_bin_path(id, o), orig_bytes, o.input_mode),
+	 command_with_patched_bin(substitute_file_path(o.command_args, file.path())),
+	 kill_grace_ms(o.kill_grace_ms),
+	 cpu_limit_s(o.cpu_limit_s),
+	 memory_limit_mb(o.memory_limit_mb),
+	 use_stdin(o.input_mode == input_mode::stdin),
+	 forkserver_shim_path(o.forkserver_shim_path),
+ use_spawner(uses_spawner(o)),
+	 use_perf_counters(o.perf_counters)
+	{
+		std::copy_if(o.layout.begin(), o.layout.end(), std::back_inserter(checksums), [](const field& f) { return f.is_checksum(); });
+
+		if (o.coverage)
+			coverage = std::make_unique<coverage_map>();
+	}
+
+	cmd_res worker::execute(const patch& p, const u64 execution_time_limit_ns)
+	{
+		if (use_perf_counters && !counters)
+			counters = std::make_unique<perf_counters>();
+
+		// the forkserver can't write into a pipe for each of its children, so it
+		// gets the in-memory file as its stdin instead and rewinds it for each run
+		const i32 coverage_fd = coverage ? coverage->file_descriptor() : -1;
+
+		if (!forkserver_shim_path.empty() && !fserver)
+			fserver = std::make_unique<forkserver>(command_with_patched_bin, forkserver_shim_path, use_stdin ? file.file_descriptor() : -1, coverage_fd);
+
+		if (use_spawner && !cmd_spawner)
+			cmd_spawner = std::make_unique<spawner>(command_with_patched_bin, coverage_fd);
+
+		timer patch_timer;
+		patch_timer.start();
+		file.apply(p);
+
+		if (!checksums.empty())
+			file.fix_checksums(checksums);
+
+		const u64 patch_time = patch_timer.elapsed_nanos();
+
+		exec_limits limits;
+		limits.time_limit_ns = execution_time_limit_ns;
+		limits.kill_grace_ms = kill_grace_ms;
+		limits.cpu_limit_s = cpu_limit_s;
+		limits.memory_limit_mb = memory_limit_mb;
+
+		// if the cpu time limit wasn't set explicitly, use a limit that is a bit
+		// higher than the time limit so that it only kicks in if killing the
+		// command at the deadline didn't work for some reason
+		if (limits.cpu_limit_s == 0 && execution_time_limit_ns != no_time_limit)
+			limits.cpu_limit_s = execution_time_limit_ns / 1'000'000'000 + 2;
+
+		if (coverage)
+			coverage->clear();
+
+		const perf_counters::values counters_before = counters ? counters->read() : perf_counters::values{};
+
+		const std::span<const u8> stdin_bytes = use_stdin ? file.bytes() : std::span<const u8>();
+
+		cmd_res res;
+		if (fserver)
+			res = fserver->run(limits);
+		else if (cmd_spawner)
+			res = cmd_spawner->run(limits, stdin_bytes);
+		else
+			res = run_cmd(command_with_patched_bin, limits, stdin_bytes, coverage_fd);
+
+		if (counters)
+		{
+			const perf_counters::values counters_after = counters->read();
+			res.instructions = counters_after.instructions - counters_before.instructions;
+			res.branches = counters_after.branches - counters_before.branches;
+			res.page_faults = counters_after.page_faults - counters_before.page_faults;
+		}
+
+		res.patch_time = patch_time;
+		return res;
+	}
+
+	std::span<const u8> worker::coverage_counters() const noexcept
+	{
+		return coverage ? coverage->counters() : std::span<const u8>();
+	}
+}
@@ -0,0 +1,80 @@
+#include "worker_pool.hpp"
+
+#include <cassert>
+
+namespace fuzz
+{
+	worker_pool::worker_pool(const opts& o, const std::vector<u8>& orig_bytes, const u64 seed)
+	{
+		assert(o.jobs > 0);
+
+		for (u64 i = 0; i < o.jobs; ++i)
+			workers.push_back(std::make_unique<worker>(i, o, orig_bytes, seed));
+
+		for (std::unique_ptr<worker>& w : workers)
+			threads.emplace_back(&worker_pool::work, this, std::ref(*w));
+	}
+
+	worker_pool::~worker_pool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		job_cv.notify_all();
+
+		for (std::thread& t : threads)
+			t.join();
+	}
+
+	u64 worker_pool::size() const noexcept
+	{
+		return workers.size();
+	}
+
+	void worker_pool::reseed(const u64 seed)
+	{
+		for (std::unique_ptr<worker>& w : workers)
+			w->rng = rng(seed + w->id);
+	}
+
+	void worker_pool::run(const u64 count, const job_fn& job)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+
+		current_job = &job;
+		job_count = count;
+		next_job = 0;
+		finished_jobs = 0;
+
+		job_cv.notify_all();
+		done_cv.wait(lock, [this] { return finished_jobs == job_count; });
+
+		current_job = nullptr;
+	}
+
+	void worker_pool::work(worker& w)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+
+		while (true)
+		{
+			job_cv.wait(lock, [this] { return stopping || next_job < job_count; });
+
+			if (stopping)
+				return;
+
+			const u64 index = next_job++;
+			const job_fn& job = *current_job;
+
+			// the job itself is run without holding the lock so that
+			// the other workers can pick up jobs in the meantime
+			lock.unlock();
+			job(w, index);
+			lock.lock();
+
+			if (++finished_jobs == job_count)
+				done_cv.notify_one();
+		}
+	}
+}